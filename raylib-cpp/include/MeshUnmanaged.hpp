@@ -388,6 +388,10 @@ class MeshUnmanaged : public ::Mesh {
 };
 
 inline BoundingBox Model::GetTransformedBoundingBox() const {
+    return GetTransformedBoundingBox(transform);
+}
+
+inline BoundingBox Model::GetTransformedBoundingBox(const ::Matrix& transform) const {
     BoundingBox bounds = {};
 
     if (meshCount > 0)
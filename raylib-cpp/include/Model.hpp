@@ -169,6 +169,16 @@ class Model : public ::Model {
         ::DrawModelEx(*this, position, rotationAxis, rotationAngle, scale, tint);
     }
 
+    /**
+     * Draw a model with the given transform in place of the model's own, which is left untouched
+     * (so several threads can prepare draws of the same model)
+     */
+    void Draw(const ::Matrix& transform) const {
+        for (int i = 0; i < meshCount; i++) {
+            ::DrawMesh(meshes[i], materials[meshMaterial[i]], transform);
+        }
+    }
+
     /**
      * Draw a model wires (with texture if set)
      */
@@ -203,6 +213,12 @@ class Model : public ::Model {
      */
     BoundingBox GetTransformedBoundingBox() const;
 
+    /**
+     * Compute model bounding box limits with respect to the given transformation (considers all meshes)
+     * This function is pretty expensive!
+     */
+    BoundingBox GetTransformedBoundingBox(const ::Matrix& transform) const;
+
     /**
      * Compute model bounding box limits (considers all meshes)
      */
@@ -3,6 +3,12 @@
 
 // inlcude standard libraries for memorory management, data structures, and type uitilities
 #include <memory>
+#include <map>
+#include <array>
+#include <tuple>
+#include <limits>
+#include <cstring>
+#include <algorithm>
 #include <concepts>
 #include <vector>
 #include <deque>
@@ -12,25 +18,295 @@
 #include <span>
 #include <variant>
 #include <cassert>
+#include <bit>
+#include <type_traits>
+#include <string_view>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <optional>
+#include <thread>
+#include "jobs.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+	#include <immintrin.h>
+#endif
 
-// external variable to track global component count
-extern size_t globalComponentCounter;
 namespace cs381 {
 
-	// generate a unique component ID for each component type using static variable
+	constexpr size_t MaxComponents = 63;	// component IDs must fit in a Signature (one bit is reserved for liveness)
+
+	// name of a type as spelled by the compiler, e.g. "TransformComponent"
 	template<typename T>
-	size_t GetComponentID(T reference = {}) {
-		static size_t id = globalComponentCounter++;
+	constexpr std::string_view ComponentName() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		std::string_view name = __FUNCSIG__;							// "... ComponentName<struct T>(void)"
+		size_t start = name.find("ComponentName<") + 14;
+		name = name.substr(start, name.rfind(">(void)") - start);
+		for(std::string_view prefix: {"struct ", "class ", "enum "})
+			if(name.starts_with(prefix)) name.remove_prefix(prefix.size());
+		return name;
+#else
+		std::string_view name = __PRETTY_FUNCTION__;					// "... [with T = T; ...]" (gcc) or "... [T = T]" (clang)
+		size_t start = name.find("T = ") + 4;
+		return name.substr(start, name.find_first_of(";]", start) - start);
+#endif
+	}
+
+	// 64-bit FNV-1a hash of a component's name, stable across runs and binaries built by the same compiler
+	template<typename T>
+	constexpr uint64_t ComponentHash() {
+		uint64_t hash = 14695981039346656037ull;
+		for(char c: ComponentName<T>())
+			hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+		return hash;
+	}
+
+	// lists every component type of the application, a component's ID is its position in the list
+	template<typename... Tcomponents>
+	struct ComponentList {
+		static constexpr size_t size = sizeof...(Tcomponents);
+		static constexpr std::array<uint64_t, size> hashes = {ComponentHash<Tcomponents>()...};
+		static constexpr std::array<std::string_view, size> names = {ComponentName<Tcomponents>()...};
+
+		template<typename T>
+		static constexpr size_t IndexOf() {								// size if T isn't in the list
+			constexpr bool matches[] = {std::is_same_v<T, Tcomponents>..., false};
+			for(size_t i = 0; i < size; i++)
+				if(matches[i]) return i;
+			return size;
+		}
+
+		static constexpr bool Unique() {								// no type appears twice and no two names hash the same
+			constexpr size_t ids[] = {IndexOf<Tcomponents>()..., 0};
+			for(size_t i = 0; i < size; i++) {
+				if(ids[i] != i) return false;
+				for(size_t j = 0; j < i; j++)
+					if(hashes[i] == hashes[j]) return false;
+			}
+			return true;
+		}
+
+		static_assert(size <= MaxComponents, "too many components to fit in a Signature");
+		static_assert(Unique(), "component list contains a duplicate type or a type name hash collision");
+	};
+
+	// the application declares its components once, before any Scene is used, by specializing this template:
+	//     template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<TransformComponent, RenderComponent> {};
+	// (only declarations of the component types are needed at that point)
+	template<typename = void>
+	struct ComponentRegistry;
+
+	// the registry as seen from a template, lookup is deferred until the template is instantiated
+	template<typename Dependent>
+	using RegisteredComponents = ComponentRegistry<std::void_t<Dependent>>;
+
+	// ID of a component type, a compile time constant taken from the ComponentRegistry
+	template<typename T>
+	constexpr size_t GetComponentID() {
+		constexpr size_t id = RegisteredComponents<T>::template IndexOf<T>();
+		static_assert(id < RegisteredComponents<T>::size, "component type is missing from the ComponentRegistry");
 		return id;
 	}
 
-	
-	using Entity = uint8_t; // basic componenet storage using a contiguous byte array
+
+	// generational entity handle: the low EntityIndexBits pick a slot, the high bits count how many times that slot has been reused
+	// storages are indexed by EntityIndex(e); the generation only exists to detect handles to destroyed entities
+	using Entity = uint32_t;
+	constexpr size_t EntityIndexBits = 20;
+	constexpr Entity EntityIndexMask = (Entity(1) << EntityIndexBits) - 1;
+	constexpr Entity EntityGenerationMask = std::numeric_limits<Entity>::max() >> EntityIndexBits;
+	constexpr size_t MaxEntities = EntityIndexMask;							// the all-ones index is reserved for InvalidEntity
+	constexpr Entity InvalidEntity = std::numeric_limits<Entity>::max();
+
+	constexpr size_t EntityIndex(Entity e) { return e & EntityIndexMask; }
+	constexpr Entity EntityGeneration(Entity e) { return e >> EntityIndexBits; }
+	constexpr Entity MakeEntity(size_t index, Entity generation) { return Entity(index) | (generation << EntityIndexBits); }
+
+	// hands out entity slots, recycling destroyed ones through a free list
+	struct EntityAllocator {
+		static constexpr Entity FreeSlot = Entity(1) << 31;	// set in generations while a slot sits in the free list (never a valid generation)
+
+		std::vector<Entity> generations;	// current generation of every slot
+		std::vector<size_t> freeList;		// slots of destroyed entities, reused before the scene grows
+
+		size_t size() const { return generations.size(); }	// number of slots (live or free)
+
+		// returns the new entity and whether it reused a slot (in which case per-slot data must be reset rather than appended)
+		std::pair<Entity, bool> Create() {
+			if(!freeList.empty()) {
+				size_t index = freeList.back();
+				freeList.pop_back();
+				generations[index] &= ~FreeSlot;
+				return {MakeEntity(index, generations[index]), true};
+			}
+			assert(generations.size() < MaxEntities);		// ensures the index still fits in the handle
+			generations.push_back(0);
+			return {MakeEntity(generations.size() - 1, 0), false};
+		}
+
+		bool Destroy(Entity e) {							// returns false (and does nothing) if e was already destroyed
+			if(!IsAlive(e)) return false;
+			size_t index = EntityIndex(e);
+			generations[index] = ((generations[index] + 1) & EntityGenerationMask) | FreeSlot;	// invalidates every outstanding handle to this slot
+			freeList.push_back(index);
+			return true;
+		}
+
+		bool IsAlive(Entity e) const {
+			size_t index = EntityIndex(e);
+			return index < generations.size() && generations[index] == EntityGeneration(e);
+		}
+
+		Entity Get(size_t index) const {					// the live entity in a slot, InvalidEntity if the slot is free
+			return generations[index] & FreeSlot ? InvalidEntity : MakeEntity(index, generations[index]);
+		}
+	};
+
+	// component set of an entity, stored inline as a single 64-bit word
+	// the top bit marks live entities so that destroyed (zeroed) slots never match a query
+	struct Signature {
+		static constexpr size_t AliveBit = MaxComponents;
+
+		uint64_t bits = 0;
+
+		constexpr bool test(size_t id) const { return (bits >> id) & 1; }
+		constexpr Signature& set(size_t id, bool value = true) {
+			assert(id <= AliveBit);
+			bits = value ? bits | (uint64_t(1) << id) : bits & ~(uint64_t(1) << id);
+			return *this;
+		}
+		constexpr Signature& reset(size_t id) { return set(id, false); }
+
+		constexpr bool Contains(Signature required) const { return (bits & required.bits) == required.bits; }
+		constexpr bool Intersects(Signature other) const { return (bits & other.bits) != 0; }
+		constexpr bool HasComponents() const { return (bits & ~(uint64_t(1) << AliveBit)) != 0; }
+
+		static constexpr Signature Alive() { return Signature{}.set(AliveBit); }
+
+		constexpr auto operator<=>(const Signature&) const = default;
+	};
+	static_assert(sizeof(Signature) == sizeof(uint64_t), "signatures are matched as raw 64-bit lanes");
+
+	// builds the signature of a live entity holding exactly Tcomponents
+	template<typename... Tcomponents>
+	constexpr Signature MakeSignature() {
+		Signature out = Signature::Alive();
+		(out.set(GetComponentID<Tcomponents>()), ...);
+		return out;
+	}
+
+	// tests up to 64 signatures at once, bit i of the result is set if signatures[i] contains all of required and none of excluded
+	inline uint64_t MatchSignatures(const Signature* signatures, size_t count, Signature required, Signature excluded = {}) {
+		assert(count <= 64);
+		uint64_t out = 0;
+		size_t i = 0;
+#if defined(__AVX2__)
+		__m256i req = _mm256_set1_epi64x(required.bits), exc = _mm256_set1_epi64x(excluded.bits), zero = _mm256_setzero_si256();
+		for(; i + 4 <= count; i += 4) {															// 4 signatures per instruction
+			__m256i sig = _mm256_loadu_si256((const __m256i*)(signatures + i));
+			__m256i hasAll = _mm256_cmpeq_epi64(_mm256_and_si256(sig, req), req);
+			__m256i hasNone = _mm256_cmpeq_epi64(_mm256_and_si256(sig, exc), zero);
+			out |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_and_si256(hasAll, hasNone)))) << i;
+		}
+#elif defined(__SSE2__) || defined(_M_X64)
+		__m128i req = _mm_set1_epi64x(required.bits), exc = _mm_set1_epi64x(excluded.bits), zero = _mm_setzero_si128();
+		for(; i + 2 <= count; i += 2) {															// 2 signatures per instruction
+			__m128i sig = _mm_loadu_si128((const __m128i*)(signatures + i));
+			__m128i hasAll = _mm_cmpeq_epi32(_mm_and_si128(sig, req), req);						// SSE2 has no 64-bit compare, so compare both halves
+			__m128i hasNone = _mm_cmpeq_epi32(_mm_and_si128(sig, exc), zero);
+			__m128i both = _mm_and_si128(hasAll, hasNone);
+			both = _mm_and_si128(both, _mm_shuffle_epi32(both, _MM_SHUFFLE(2, 3, 0, 1)));		// a lane matches only if both of its halves do
+			out |= uint64_t(_mm_movemask_pd(_mm_castsi128_pd(both))) << i;
+		}
+#endif
+		for(; i < count; i++)																	// remainder (and non-x86 targets, which the compiler vectorizes on its own)
+			out |= uint64_t(signatures[i].Contains(required) && !signatures[i].Intersects(excluded)) << i;
+		return out;
+	}
+
+	// empty components are tags: they only occupy a bit of the signature and every entity shares this instance
+	template<typename Tcomponent>
+	concept TagComponent = std::is_empty_v<Tcomponent>;
+
+	template<TagComponent Tcomponent>
+	inline Tcomponent tagInstance{};
+
+	// mutex that can be copied along with the object owning it (every copy gets its own unlocked mutex)
+	struct CopyableMutex : std::mutex {
+		CopyableMutex() = default;
+		CopyableMutex(const CopyableMutex&) {}
+		CopyableMutex& operator=(const CopyableMutex&) { return *this; }
+	};
+
+	// query filters, passed to a Query's ForEach to only visit entities whose component changed (or was added) since that ForEach last ran
+	template<typename Tcomponent> struct Changed {};
+	template<typename Tcomponent> struct Added {};
+
+	template<typename Tfilter> struct FilterTraits;
+	template<typename Tcomponent> struct FilterTraits<Changed<Tcomponent>> { using Component = Tcomponent; static constexpr bool added = false; };
+	template<typename Tcomponent> struct FilterTraits<Added<Tcomponent>> { using Component = Tcomponent; static constexpr bool added = true; };
+
+	// list of the entities matching a signature, kept up to date by the scene whenever a signature changes
+	struct QueryCache {
+		static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+		Signature required;					// entities must have every bit of this signature
+		std::vector<Entity> entities;		// dense list of matching entities
+		std::vector<uint32_t> positions;	// entity slot -> position in entities, npos if the entity doesn't match
+		std::vector<std::pair<uint64_t, uint32_t>> lastRuns;	// filter list hash -> tick its last filtered ForEach started at
+
+		void Update(Entity e, Signature before, Signature after) {	// called with an entity's old and new signature
+			bool was = before.Contains(required), is = after.Contains(required);
+			if(was == is) return;
+
+			size_t index = EntityIndex(e);
+			if(is) {
+				if(positions.size() <= index)
+					positions.resize(index + 1, npos);
+				positions[index] = entities.size();
+				entities.push_back(e);
+			} else {												// swap and pop, so removal doesn't shift the list
+				uint32_t position = positions[index];
+				Entity last = entities.back();
+				entities[position] = last;
+				positions[EntityIndex(last)] = position;
+				entities.pop_back();
+				positions[index] = npos;
+			}
+		}
+	};
+
+	// allocator handing out memory aligned to Alignment, so component arrays start on a cache line (and suit any SIMD load)
+	template<typename T, size_t Alignment = 64>
+	struct AlignedAllocator {
+		using value_type = T;
+		template<typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+		AlignedAllocator() = default;
+		template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+		T* allocate(size_t count) { return (T*)::operator new(count * sizeof(T), std::align_val_t{Alignment}); }
+		void deallocate(T* memory, size_t count) { ::operator delete(memory, count * sizeof(T), std::align_val_t{Alignment}); }
+
+		template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	};
+
+	template<typename T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+	// memory a storage holds, as reported by its Memory()
+	struct StorageMemory {
+		size_t stored = 0;					// component slots holding data, whether or not a live entity owns them
+		size_t capacityBytes = 0;			// bytes allocated for component data
+		size_t indexBytes = 0;				// bytes of lookup structures (sparse indices, dense -> entity arrays, page tables)
+		size_t sharedBytes = 0;				// part of capacityBytes shared with copies of the storage
+	};
 
 	// basic component storage using a contiguous byte array
 	struct ComponentStorage {
 		size_t elementSize = -1;			// size of a single component
-		std::vector<std::byte> data;		// raw storage for component data
+		AlignedVector<std::byte> data;		// raw storage for component data, 64-byte aligned
 
 		// default constructor
 		ComponentStorage() : elementSize(-1), data(1, std::byte{0}) {}
@@ -54,10 +330,15 @@ namespace cs381 {
 			return *(Tcomponent*)(data.data() + e * elementSize);		// deference pointer to get a reference to the component
 		}
 
+		template<typename Tcomponent>
+		const Tcomponent& Get(Entity e) const {
+			assert(sizeof(Tcomponent) == elementSize && e < data.size() / elementSize);
+			return *(const Tcomponent*)(data.data() + e * elementSize);
+		}
+
 		template<typename Tcomponent>
 		std::pair<Tcomponent&, size_t> Allocate(size_t count = 1) {					// allocates space for a component of type Tcomponent for count entities
 			assert(sizeof(Tcomponent) == elementSize);								// ensures the size of the component matches the storage size
-			assert(count < 100);													// ensures the count is within a reasonable limit, in this case, less than 100
 			auto originalEnd = data.size();											// records the current end of the data vector in oringinalEnd
 			data.insert(data.end(), elementSize * count, std::byte{0});				// adds space for new component in the data vector by inserting count * elementSize bytes intialized to zero
 			for(size_t i = 0; i < count - 1; i++) // Skip the last one				// iterates over the newly allocated space, except the last one
@@ -79,68 +360,573 @@ namespace cs381 {
 				Allocate<Tcomponent>(std::max<int64_t>(int64_t(e) - size + 1, 1));	
 			return Get<Tcomponent>(e);												// returns a reference to the component at index e
 		}
+
+		void Grow(size_t slots) {													// makes room for slots [0, slots) in one go, leaving the new ones unconstructed (zeroed)
+			if(data.size() < slots * elementSize)
+				data.resize(slots * elementSize);
+		}
+
+		// every slot as a typed array, indexed by EntityIndex (slots of entities without the component hold stale or zeroed bytes)
+		// lets systems write plain loops over components that the compiler can vectorize, instead of calling Get per entity
+		template<typename Tcomponent>
+		std::span<Tcomponent> Span() {
+			assert(sizeof(Tcomponent) == elementSize);
+			return {std::assume_aligned<64>((Tcomponent*)data.data()), data.size() / elementSize};
+		}
+
+		StorageMemory Memory() const { return {data.size() / elementSize, data.capacity()}; }
 	};
 
 
+	// slot indexed like ComponentStorage, but split into fixed-size pages that copies of the storage share
+	// a shared page is copied the first time one of its owners writes to it, which makes copying a whole scene (Scene::Fork) cheap
+	// every mutable access counts as a write; only the const Get leaves shared pages alone
+	struct CowComponentStorage {
+		static constexpr size_t PageBytes = 16 * 1024;
+		using Page = std::shared_ptr<std::byte[]>;
+
+		size_t elementSize = -1;			// size of a single component in bytes
+		size_t perPage = 0;					// components per page
+		std::vector<Page> pages;
+		mutable std::vector<uint8_t> owned;	// 1 once this copy is known to be a page's only owner, cleared on both sides when the storage is copied
+		mutable CopyableMutex mutex;		// serializes page copies, so systems running in parallel may write to shared pages
+
+		CowComponentStorage() = default;
+		CowComponentStorage(size_t elementSize) : elementSize(elementSize), perPage(std::max<size_t>(PageBytes / elementSize, 1)) {}
+
+		// template constructor for type-based initialization
+		template<typename Tcomponent>
+		CowComponentStorage(Tcomponent reference = {}) : CowComponentStorage(sizeof(Tcomponent)) {}
+
+		CowComponentStorage(const CowComponentStorage& other) { *this = other; }
+		CowComponentStorage(CowComponentStorage&&) = default;
+		// shares every page, neither side may write to them in place anymore
+		// this clears other's ownership flags, so copying (Scene::Fork) must not overlap with writes to other from another thread
+		CowComponentStorage& operator=(const CowComponentStorage& other) {
+			if(this == &other) return *this;
+			elementSize = other.elementSize;
+			perPage = other.perPage;
+			pages = other.pages;
+			owned.assign(pages.size(), 0);
+			std::fill(other.owned.begin(), other.owned.end(), 0);
+			return *this;
+		}
+		CowComponentStorage& operator=(CowComponentStorage&&) = default;
+
+		template<typename Tcomponent>
+		const Tcomponent& Get(Entity e) const {
+			assert(sizeof(Tcomponent) == elementSize);
+			return *(const Tcomponent*)(pages[e / perPage].get() + e % perPage * elementSize);
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& Get(Entity e) {
+			assert(sizeof(Tcomponent) == elementSize);
+			assert(e / perPage < pages.size());
+			return *(Tcomponent*)(Writable(e / perPage) + e % perPage * elementSize);
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& GetOrAllocate(Entity e) {
+			assert(sizeof(Tcomponent) == elementSize);
+			while(pages.size() <= e / perPage) {								// new pages start zeroed and owned
+				pages.emplace_back(new std::byte[perPage * elementSize]());
+				owned.push_back(1);
+			}
+			return Get<Tcomponent>(e);
+		}
+
+		size_t SharedPages() const { return std::count_if(pages.begin(), pages.end(), [](const Page& page) { return page.use_count() > 1; }); }
+
+		StorageMemory Memory() const {
+			size_t pageBytes = perPage * elementSize;
+			return {pages.size() * perPage, pages.size() * pageBytes, pages.capacity() * sizeof(Page) + owned.capacity(), SharedPages() * pageBytes};
+		}
+
+	private:
+		std::byte* Writable(size_t page) {										// the page, copied first if another storage still shares it
+			if(std::atomic_ref(owned[page]).load(std::memory_order_acquire)) return pages[page].get();
+			std::scoped_lock lock(mutex);
+			if(!owned[page]) {
+				if(pages[page].use_count() > 1) {
+					Page copy(new std::byte[perPage * elementSize]);
+					std::memcpy(copy.get(), pages[page].get(), perPage * elementSize);
+					pages[page] = std::move(copy);
+				}
+				std::atomic_ref(owned[page]).store(1, std::memory_order_release);
+			}
+			return pages[page].get();
+		}
+	};
+
+
+	// remembers the tick at which every component of every entity slot was added and last changed
+	// the tick advances each time a filtered ForEach runs, so "changed since the last run" is a single comparison
+	// ticks live in copy-on-write pages, so a Fork shares them with its scene until one of the two stamps a page
+	struct ChangeTracker {
+		struct Stamp {
+			uint32_t added = 0;
+			uint32_t changed = 0;
+		};
+
+		uint32_t tick = 1;						// accessed through atomic_ref since systems stamp and advance it from several threads
+		std::vector<CowComponentStorage> components;	// indexed by component ID, entity slot -> Stamp, grown as components get added
+
+		uint32_t Now() { return std::atomic_ref(tick).load(std::memory_order_relaxed); }
+		uint32_t Advance() { return std::atomic_ref(tick).fetch_add(1, std::memory_order_relaxed); }
+
+		void Reserve(size_t id, size_t slots) {		// structural change, only called while nothing iterates
+			while(components.size() <= id) components.emplace_back(sizeof(Stamp));
+			auto& ticks = components[id];
+			if(slots > ticks.pages.size() * ticks.perPage)
+				ticks.GetOrAllocate<Stamp>(slots - 1);							// only adds pages, the shared ones stay shared
+		}
+
+		void MarkAdded(size_t id, size_t index) {
+			Reserve(id, index + 1);
+			uint32_t now = Now();
+			components[id].Get<Stamp>(index) = {now, now};
+		}
+
+		void MarkAdded(size_t id, std::span<const Entity> batch, size_t slots) {	// every entity of batch must have a slot below slots
+			Reserve(id, slots);
+			auto& ticks = components[id];
+			uint32_t now = Now();
+			for(Entity e: batch)
+				ticks.Get<Stamp>(EntityIndex(e)) = {now, now};
+		}
+
+		void MarkAllAdded(size_t count, size_t slots) {	// stamps every slot of the first count components as added now, e.g. after loading a snapshot
+			uint32_t now = Now();
+			components.clear();
+			for(size_t id = 0; id < count; id++) {
+				Reserve(id, slots);
+				for(size_t index = 0; index < slots; index++)
+					components[id].Get<Stamp>(index) = {now, now};
+			}
+		}
+
+		void MarkChanged(size_t id, size_t index) { components[id].Get<Stamp>(index).changed = Now(); }	// the component must have been added
+
+		template<typename Tfilter>
+		bool Passes(size_t index, uint32_t since) const {
+			const Stamp& stamp = components[GetComponentID<typename FilterTraits<Tfilter>::Component>()].template Get<Stamp>(index);
+			return (FilterTraits<Tfilter>::added ? stamp.added : stamp.changed) > since;
+		}
+
+		StorageMemory Memory() const {
+			StorageMemory out;
+			for(auto& ticks: components) {
+				StorageMemory memory = ticks.Memory();
+				out.capacityBytes += memory.capacityBytes + memory.indexBytes;
+				out.sharedBytes += memory.sharedBytes;
+			}
+			return out;
+		}
+
+		// tick the previous run of a filtered ForEach started at (0 if it never ran), records the current run in lastRuns
+		template<typename... Tfilters>
+		uint32_t Begin(std::vector<std::pair<uint64_t, uint32_t>>& lastRuns, std::mutex& mutex) {
+			constexpr uint64_t key = ComponentHash<std::tuple<Tfilters...>>();
+			std::scoped_lock lock(mutex);
+			uint32_t now = Advance();
+			for(auto& [filters, lastRun]: lastRuns)
+				if(filters == key) return std::exchange(lastRun, now);
+			lastRuns.emplace_back(key, now);
+			return 0;
+		}
+
+		// wraps fn so it is only called for entities passing every filter, and always reports whether to keep going
+		template<typename... Tfilters, typename F>
+		auto Filter(uint32_t since, F& fn) {
+			return [this, since, &fn](Entity e, auto&... components) {
+				if(!(Passes<Tfilters>(EntityIndex(e), since) && ...)) return true;
+				if constexpr (std::is_same_v<std::invoke_result_t<F, Entity, decltype(components)...>, bool>)
+					return fn(e, components...);
+				else {
+					fn(e, components...);
+					return true;
+				}
+			};
+		}
+	};
+
+	// storages which can release a single entity's component (the others only ever grow)
+	template<typename Storage>
+	concept RemovableStorage = requires(Storage storage, Entity e) { storage.Remove(e); };
+
+	// memory and occupancy of one component type, see Scene::Stats
+	struct ComponentStats {
+		std::string_view name;
+		size_t elementSize = 0;				// 0 for tags, which take no memory beyond their signature bit
+		size_t live = 0;					// entities that have the component
+		size_t stored = 0;					// component slots the storage holds, live or not
+		size_t capacityBytes = 0;			// bytes allocated for component data
+		size_t indexBytes = 0;				// bytes of the storage's lookup structures
+		size_t sharedBytes = 0;				// part of capacityBytes shared with forks of the scene
+		size_t wastedBytes = 0;				// capacityBytes not holding a live component (dead slots plus unused capacity)
+		float fragmentation = 0;			// share of the stored slots that don't hold a live component
+	};
+
+	// snapshot of a scene's memory use, cheap enough to take every frame: one pass over the entity signatures plus a few size() calls per container
+	struct SceneStats {
+		std::vector<ComponentStats> components;	// in component ID order
+		size_t entities = 0;				// live entities
+		size_t slots = 0;					// entity slots, live or free
+		size_t freeSlots = 0;
+		size_t maskBytes = 0;				// entityMasks
+		size_t entityBytes = 0;				// generations and free list
+		size_t indexBytes = 0;				// scene wide lookup structures (e.g. archetype locations)
+		size_t queryBytes = 0;				// registered queries
+		size_t changeBytes = 0;				// change ticks for Changed/Added filters
+		size_t changeSharedBytes = 0;		// part of changeBytes shared with forks of the scene
+
+		size_t ComponentBytes() const { size_t out = 0; for(auto& c: components) out += c.capacityBytes; return out; }
+		size_t WastedBytes() const { size_t out = 0; for(auto& c: components) out += c.wastedBytes; return out; }
+		size_t TotalBytes() const {
+			size_t out = maskBytes + entityBytes + indexBytes + queryBytes + changeBytes;
+			for(auto& c: components) out += c.capacityBytes + c.indexBytes;
+			return out;
+		}
+	};
+
+	// counts the live entities having each component (index AliveBit counts live entities)
+	inline std::array<size_t, MaxComponents + 1> CountComponents(std::span<const Signature> masks) {
+		std::array<size_t, MaxComponents + 1> counts{};
+		for(Signature mask: masks)
+			for(uint64_t bits = mask.bits; bits; bits &= bits - 1)
+				counts[std::countr_zero(bits)]++;
+		return counts;
+	}
+
+	inline void FillComponentStats(ComponentStats& stats, size_t elementSize, StorageMemory memory) {
+		stats.elementSize = elementSize;
+		stats.stored = memory.stored;
+		stats.capacityBytes = memory.capacityBytes;
+		stats.indexBytes = memory.indexBytes;
+		stats.sharedBytes = memory.sharedBytes;
+		stats.wastedBytes = memory.capacityBytes - std::min(memory.capacityBytes, stats.live * elementSize);
+		stats.fragmentation = memory.stored ? 1 - float(std::min(stats.live, memory.stored)) / memory.stored : 0;
+	}
+
+	// component values every instance of a prefab starts with, instantiated with Scene::Spawn
+	template<typename... Tcomponents>
+	struct Prefab {
+		std::tuple<Tcomponents...> components;
+	};
+
 	template<typename Storage = ComponentStorage>					// template parameter w/ a default storage value of ComponentStorage 
 	struct Scene {
-		std::vector<std::vector<bool>> entityMasks;					// vectors of vectors of booleans; each vector represents an entity and boolean represents if a component is associated with said entity
-		std::vector<Storage> storages = {Storage()};				// vector that stores storage objects for each component type 
-
-		template<typename Tcomponent>																		// starts the template function to work with any type Tcomponent
-		Storage& GetStorage() {																				// returns a reference to the storage object for the component type Tcomponent
-			size_t id = GetComponentID<Tcomponent>();														// gets the component ID for the requested component type
-			if(storages.size() <= id)																		// checks if current size of storages is less than equal to id
-																											// if so, it means that the storages vector doesn't have enough storage for the requested component type
-				storages.insert(storages.cend(), std::max<int64_t>(id - storages.size(), 1), Storage());	// inserts a number of storage elements into storages to ensure there's enough room for the requested id 
-																											// id - storages.size() gives the number of new storages to insert
-																											// std::max<int64_t>(id - storages.size(), 1) ensures at least one new storage is inserted
-			if (storages[id].elementSize == std::numeric_limits<size_t>::max())								// checks if elementSize of tht Storage position at position id is equal to the maximum possible value of size_t
-																											// if so, it means that the Storage for this component type has not been initialized yet
-				storages[id] = Storage(Tcomponent{});														// creates new Storage object and assigns it to storages[id] with an empty object of type Tcomponent
-			return storages[id];																			// returns a reference to the Storage object for the component type Tcomponent at index id in the storages vector
+		std::vector<Signature> entityMasks;							// signature of every entity slot, dense so queries can scan it with SIMD
+		std::vector<Storage> storages = MakeStorages(RegisteredComponents<Storage>{});	// one storage per registered component, indexed by component ID
+		EntityAllocator entities;									// generation of every entity slot plus the free list of destroyed slots
+		std::deque<QueryCache> queries;								// every query registered through GetQuery (a deque so Query views stay valid as more are added)
+		CopyableMutex queryMutex;									// lets systems running in parallel call GetQuery
+		ChangeTracker changes;										// when each component was added and last changed, for Changed/Added filters
+
+		// persistent view over the entities that have ALL of Tcomponents, obtained from GetQuery
+		template<typename... Tcomponents>
+		struct Query {
+			Scene* scene;
+			QueryCache* cache;
+
+			size_t size() const { return cache->entities.size(); }
+			auto begin() const { return cache->entities.begin(); }
+			auto end() const { return cache->entities.end(); }
+
+			// calls fn(entity, components...) for every matching entity, fn may return false to stop early
+			// fn must not add or remove any of Tcomponents while iterating (the list would be reordered under it)
+			// with Changed<T>/Added<T> filters, only entities whose T changed/was added since this query last ran with the same filters are visited
+			template<typename... Tfilters, typename F>
+			void ForEach(F&& fn) {
+				if constexpr (sizeof...(Tfilters) > 0) {
+					auto filtered = scene->changes.template Filter<Tfilters...>(scene->changes.template Begin<Tfilters...>(cache->lastRuns, scene->queryMutex), fn);
+					return ForEach(filtered);
+				}
+				for(size_t i = 0; i < cache->entities.size(); i++) {
+					Entity e = cache->entities[i];
+					if constexpr (std::is_same_v<std::invoke_result_t<F, Entity, Tcomponents&...>, bool>) {
+						if(!fn(e, scene->template GetComponentAt<Tcomponents>(EntityIndex(e))...)) return;
+					} else fn(e, scene->template GetComponentAt<Tcomponents>(EntityIndex(e))...);
+				}
+			}
+
+			// calls fn(entity, components...) for every matching entity, spread over the job system in ranges of grain entities
+			// fn runs concurrently so it may only touch the components it is given (and other data it synchronizes itself)
+			template<typename... Tfilters, typename F>
+			void ParallelForEach(F&& fn, size_t grain = 1024, JobSystem& jobs = JobSystem::Default()) {
+				if constexpr (sizeof...(Tfilters) > 0) {
+					auto filtered = scene->changes.template Filter<Tfilters...>(scene->changes.template Begin<Tfilters...>(cache->lastRuns, scene->queryMutex), fn);
+					return ParallelForEach(filtered, grain, jobs);
+				}
+				jobs.ParallelFor(cache->entities.size(), grain, [&](size_t begin, size_t end) {
+					for(size_t i = begin; i < end; i++) {
+						Entity e = cache->entities[i];
+						fn(e, scene->template GetComponentAt<Tcomponents>(EntityIndex(e))...);
+					}
+				});
+			}
+		};
+
+		// registers (on first use) and returns the query matching every entity with ALL of Tcomponents
+		// the cost of iterating it is proportional to the number of matches, not the number of entities
+		template<typename... Tcomponents>
+		Query<Tcomponents...> GetQuery() {
+			constexpr Signature required = MakeSignature<Tcomponents...>();
+			std::scoped_lock lock(queryMutex);
+			for(auto& query: queries)
+				if(query.required == required)
+					return {this, &query};
+
+			auto& query = queries.emplace_back();
+			query.required = required;
+			Fill(query);
+			return {this, &query};
+		}
+
+		void Fill(QueryCache& query) {								// (re)builds a query's entity list from scratch
+			query.entities.clear();
+			query.positions.clear();
+			for(size_t block = 0; block < entityMasks.size(); block += 64)
+				for(uint64_t matches = MatchSignatures(entityMasks.data() + block, std::min<size_t>(64, entityMasks.size() - block), query.required); matches; matches &= matches - 1) {
+					size_t index = block + std::countr_zero(matches);
+					query.Update(GetEntity(index), {}, entityMasks[index]);
+				}
+		}
+
+		void SetSignature(Entity e, Signature signature) {			// changes an entity's signature and moves it in or out of every registered query
+			auto& eMask = entityMasks[EntityIndex(e)];
+			for(auto& query: queries)
+				query.Update(e, eMask, signature);
+			eMask = signature;
+		}
+
+		template<typename... Tcomponents>
+		static std::vector<Storage> MakeStorages(ComponentList<Tcomponents...>) {	// builds every storage up front so lookups never branch
+			std::vector<Storage> out;
+			out.reserve(sizeof...(Tcomponents));
+			(out.push_back(MakeStorage<Tcomponents>()), ...);
+			return out;
+		}
+
+		template<typename Tcomponent>
+		static Storage MakeStorage() {
+			if constexpr (TagComponent<Tcomponent>)
+				return Storage();												// tags never touch their storage, leave it uninitialized
+			else return Storage(Tcomponent{});
+		}
+
+		template<typename Tcomponent>
+		Storage& GetStorage() {													// returns a reference to the storage object for the component type Tcomponent
+			static_assert(!TagComponent<Tcomponent>, "tag components have no storage");
+			return storages[GetComponentID<Tcomponent>()];						// the ID is a constant, so this is a direct index
+		}
+
+		template<typename Tcomponent>
+		const Storage& GetStorage() const {
+			static_assert(!TagComponent<Tcomponent>, "tag components have no storage");
+			return storages[GetComponentID<Tcomponent>()];
+		}
+
+		// copy of the scene to simulate ahead with and throw away, registered queries and change ticks included
+		// change ticks are shared page by page until either scene stamps them; with CowComponentStorage so are the components, other storages copy everything
+		// fork between ticks: forking while another thread writes to this scene is a data race
+		Scene Fork() const { return *this; }
+
+		SceneStats Stats() const {
+			constexpr auto& names = RegisteredComponents<Storage>::names;
+			auto live = CountComponents(entityMasks);
+			SceneStats out;
+			out.components.resize(names.size());
+			for(size_t id = 0; id < names.size(); id++) {
+				auto& stats = out.components[id];
+				stats.name = names[id];
+				stats.live = live[id];
+				if(storages[id].elementSize != size_t(-1))			// tags have an unused storage
+					FillComponentStats(stats, storages[id].elementSize, storages[id].Memory());
+			}
+			out.entities = live[Signature::AliveBit];
+			out.slots = entityMasks.size();
+			out.freeSlots = entities.freeList.size();
+			out.maskBytes = entityMasks.capacity() * sizeof(Signature);
+			out.entityBytes = entities.generations.capacity() * sizeof(Entity) + entities.freeList.capacity() * sizeof(size_t);
+			for(auto& query: queries)
+				out.queryBytes += sizeof(QueryCache) + query.entities.capacity() * sizeof(Entity) + query.positions.capacity() * sizeof(uint32_t) + query.lastRuns.capacity() * sizeof(query.lastRuns[0]);
+			StorageMemory ticks = changes.Memory();
+			out.changeBytes = ticks.capacityBytes;
+			out.changeSharedBytes = ticks.sharedBytes;
+			return out;
 		}
 
 		Entity CreateEntity() {										// creates new entity in ECS system
-			Entity e = entityMasks.size();							// number of entities in the system; index/ID of the new entity
-			entityMasks.emplace_back(std::vector<bool>{false});		// adds a new element to the entityMasks vector
-																	// std::vector<bool>{false} creates a new vector of booleans with one element initialized to false 
-																	// (doesn't have component yet)
-			return e;												// returns the index/ID of the new entity
+			auto [e, recycled] = entities.Create();					// reuses the slot of a destroyed entity when one is available
+			if(!recycled) entityMasks.emplace_back();				// adds a new (empty) signature to the entityMasks vector
+			SetSignature(e, Signature::Alive());					// the entity is alive but doesn't have any components yet
+			return e;												// returns the handle of the new entity
+		}
+
+		void DestroyEntity(Entity e) {								// removes every component of e and releases its slot for reuse
+			if(!IsAlive(e)) return;									// stale handles are ignored
+			if constexpr (RemovableStorage<Storage>) {				// storages that can free a component do so, the rest keep the data until the slot gets that component again
+				Signature eMask = entityMasks[EntityIndex(e)];
+				for(size_t id = 0; id < storages.size(); id++)
+					if(eMask.test(id)) storages[id].Remove(EntityIndex(e));
+			}
+			SetSignature(e, {});
+			entities.Destroy(e);
+		}
+
+		bool IsAlive(Entity e) const { return entities.IsAlive(e); }	// false for handles to destroyed entities
+
+		// creates count entities with ALL of Tcomponents (value initialized) in one batch, then calls init(i, entity, components...) for the i-th one
+		// signatures, queries, change ticks and storages are grown once for the whole batch rather than once per component of every entity
+		template<typename... Tcomponents, typename F>
+		std::vector<Entity> Spawn(size_t count, F&& init) {
+			constexpr Signature signature = MakeSignature<Tcomponents...>();
+			std::vector<Entity> spawned(count);
+			size_t slots = entityMasks.size();
+			for(auto& e: spawned) {
+				e = entities.Create().first;
+				slots = std::max(slots, EntityIndex(e) + 1);
+			}
+			entityMasks.resize(slots);
+			for(auto& query: queries)
+				if(signature.Contains(query.required)) {
+					query.entities.reserve(query.entities.size() + count);
+					query.positions.resize(std::max(query.positions.size(), slots), QueryCache::npos);
+					for(Entity e: spawned) query.Update(e, {}, signature);
+				}
+			for(Entity e: spawned)
+				entityMasks[EntityIndex(e)] = signature;
+
+			(Construct<Tcomponents>(spawned, slots), ...);
+			for(size_t i = 0; i < count; i++)
+				init(i, spawned[i], GetComponentAt<Tcomponents>(EntityIndex(spawned[i]))...);
+			return spawned;
+		}
+
+		// spawns count copies of prefab, init(i, entity, components...) may then adjust each one
+		template<typename... Tcomponents, typename F>
+		std::vector<Entity> Spawn(const Prefab<Tcomponents...>& prefab, size_t count, F&& init) {
+			return Spawn<Tcomponents...>(count, [&](size_t i, Entity e, Tcomponents&... components) {
+				((components = std::get<Tcomponents>(prefab.components)), ...);
+				init(i, e, components...);
+			});
+		}
+
+		template<typename... Tcomponents>
+		std::vector<Entity> Spawn(const Prefab<Tcomponents...>& prefab, size_t count) {
+			return Spawn(prefab, count, [](size_t, Entity, Tcomponents&...) {});
 		}
 
+		Entity GetEntity(size_t index) const { return entities.Get(index); }	// handle of the entity living in a slot, InvalidEntity if the slot is free
+
 		template<typename Tcomponent>												
 		Tcomponent& AddComponent(Entity e) {										// adds a component of type Tcomponent to the entity e
+			assert(IsAlive(e));														// ensures the handle doesn't refer to a destroyed entity
 			size_t id = GetComponentID<Tcomponent>();								// gets the component ID for the requested component type stored in id
-			auto& eMask = entityMasks[e];											// accessing the mask of entity e
-			if(eMask.size() <= id)												 	// checks if the entity's mask has enough space to store new component's status (true/false)
-																					// if so, the entity has not been assigned components with higher IDs yet
-				eMask.resize(id + 1, false);										// resizes  the mask to make room for the new component
-																					// it resizes the mask to have a least id + 1 elements, and it initializes the new elements to false
-			eMask[id] = true;														// sets component's mask index id to true; that the entity e now has the component Tcomponent.
-			return GetStorage<Tcomponent>().template GetOrAllocate<Tcomponent>(e);	// returns a reference to the component of type Tcomponent associated with entity e
+			Signature eMask = entityMasks[EntityIndex(e)];							// copy of the signature of entity e
+			bool existed = eMask.test(id);											// remembers if the entity already had the component
+			if(!existed) SetSignature(e, eMask.set(id));							// sets component's bit in the signature; the entity e now has the component Tcomponent.
+			if(existed) changes.MarkChanged(id, EntityIndex(e));					// the caller gets a mutable reference either way
+			else changes.MarkAdded(id, EntityIndex(e));
+			if constexpr (TagComponent<Tcomponent>)
+				return tagInstance<Tcomponent>;										// tags live only in the signature
+			else {
+				auto& component = GetStorage<Tcomponent>().template GetOrAllocate<Tcomponent>(EntityIndex(e));
+				if(!existed) new(&component) Tcomponent();							// the slot may hold a removed or destroyed entity's old component, reset it
+				return component;													// returns a reference to the component of type Tcomponent associated with entity e
+			}
 		}
 
 		template<typename Tcomponent>
 		void RemoveComponent(Entity e) {				// removes a component of type Tcomponent from the entity e
-			size_t id = GetComponentID<Tcomponent>();	// gets the component ID for the requested component type
-			auto& eMask = entityMasks[e];				// accessing the mask of entity e
-			if(eMask.size() > id)						// checks if the entity's mask has enough space to store new component's status (true/false)
-				eMask[id] = false;						// sets component's mask index id to false; that the entity e no longer has the component Tcomponent
+			if(!HasComponent<Tcomponent>(e)) return;	// stale handles (or entities without the component) have nothing to remove
+			SetSignature(e, Signature(entityMasks[EntityIndex(e)]).reset(GetComponentID<Tcomponent>()));	// clears the component's bit; the entity e no longer has the component Tcomponent
+			if constexpr (RemovableStorage<Storage> && !TagComponent<Tcomponent>)
+				GetStorage<Tcomponent>().Remove(EntityIndex(e));						// frees the slot in storages that support it
 		}
 
 		template<typename Tcomponent>
 		Tcomponent& GetComponent(Entity e) {								
-			size_t id = GetComponentID<Tcomponent>();						// gets the component ID for the requested component type
-			assert(entityMasks[e][id]);										// checks if the entity e has the component Tcomponent
-			return GetStorage<Tcomponent>().template Get<Tcomponent>(e);	// returns a reference to the component of type Tcomponent associated with entity e
+			assert(HasComponent<Tcomponent>(e));							// checks if the entity e is alive and has the component Tcomponent
+			return GetComponentAt<Tcomponent>(EntityIndex(e));				// returns a reference to the component of type Tcomponent associated with entity e
+		}
+
+		// read only access, goes through the storage's const Get: with CowComponentStorage, reading a page shared with a fork doesn't copy it
+		template<typename Tcomponent>
+		const Tcomponent& GetComponent(Entity e) const {
+			assert(HasComponent<Tcomponent>(e));
+			return GetComponentAt<Tcomponent>(EntityIndex(e));
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& GetMutable(Entity e) {									// GetComponent for writing, stamps the component as changed
+			MarkChanged<Tcomponent>(e);
+			return GetComponent<Tcomponent>(e);
+		}
+
+		template<typename Tcomponent>
+		void MarkChanged(Entity e) {										// for writes made through references obtained elsewhere (e.g. ForEach)
+			assert(HasComponent<Tcomponent>(e));
+			changes.MarkChanged(GetComponentID<Tcomponent>(), EntityIndex(e));
+		}
+
+		template<typename Tcomponent>
+		bool HasComponent(Entity e) const {
+			return IsAlive(e)												// a destroyed entity has no components, even if its slot has been reused
+				&& entityMasks[EntityIndex(e)].test(GetComponentID<Tcomponent>());
+		}
+
+		// calls fn(entity, components...) for every entity that has ALL of Tcomponents
+		// fn may return false to stop the iteration early, components listed as const (ForEach<const A, B>) are only read, see GetComponentAt
+		template<typename... Tcomponents, typename F>
+		void ForEach(F&& fn) {
+			Signature required = MakeSignature<std::remove_const_t<Tcomponents>...>();
+			for(size_t block = 0; block < entityMasks.size(); block += 64) {		// re-reads entityMasks every block, so fn may create entities
+				uint64_t matches = MatchSignatures(entityMasks.data() + block, std::min<size_t>(64, entityMasks.size() - block), required);
+				for(; matches; matches &= matches - 1) {
+					size_t index = block + std::countr_zero(matches);
+					if constexpr (std::is_same_v<std::invoke_result_t<F, Entity, Tcomponents&...>, bool>) {
+						if(!fn(GetEntity(index), GetComponentAt<Tcomponents>(index)...)) return;
+					} else fn(GetEntity(index), GetComponentAt<Tcomponents>(index)...);
+				}
+			}
 		}
 
 		template<typename Tcomponent>
-		bool HasComponent(Entity e) {
-			size_t id = GetComponentID<Tcomponent>();					// gets the component ID for the requested component type
-			return entityMasks[e].size() > id && entityMasks[e][id];	// checks if the entity e has the component Tcomponent by
-																		// checking if the mask has enough space and if the component is set to true
+		void Construct(const std::vector<Entity>& spawned, size_t slots) {	// Spawn's per-component pass
+			changes.MarkAdded(GetComponentID<Tcomponent>(), spawned, slots);
+			if constexpr (!TagComponent<Tcomponent>) {
+				auto& storage = GetStorage<Tcomponent>();
+				if constexpr (requires { storage.Grow(slots); }) {
+					storage.Grow(slots);									// every slot is in range now, skip GetOrAllocate's size check
+					for(Entity e: spawned)
+						new(&storage.template Get<Tcomponent>(EntityIndex(e))) Tcomponent();
+				} else for(Entity e: spawned)
+					new(&storage.template GetOrAllocate<Tcomponent>(EntityIndex(e))) Tcomponent();
+			}
+		}
+
+		template<typename Tcomponent>
+		std::span<Tcomponent> Span() { return GetStorage<Tcomponent>().template Span<Tcomponent>(); }	// the component's storage as a typed array, see the storage's Span
+
+		// unchecked access by slot index, for callers that already matched the signature
+		// a const Tcomponent is read through the storage's const Get, so copy-on-write storages don't copy the page it sits on
+		template<typename Tcomponent>
+		Tcomponent& GetComponentAt(size_t index) {
+			if constexpr (std::is_const_v<Tcomponent>)
+				return std::as_const(*this).template GetComponentAt<std::remove_const_t<Tcomponent>>(index);
+			else if constexpr (TagComponent<Tcomponent>)
+				return tagInstance<Tcomponent>;
+			else return GetStorage<Tcomponent>().template Get<Tcomponent>(index);
+		}
+
+		template<typename Tcomponent>
+		const Tcomponent& GetComponentAt(size_t index) const {
+			if constexpr (TagComponent<Tcomponent>)
+				return tagInstance<Tcomponent>;
+			else return GetStorage<Tcomponent>().template Get<Tcomponent>(index);
 		}
 	};
 
@@ -149,14 +935,65 @@ namespace cs381 {
 
 	// Niceties!
 
+	// maps entity slots to 32-bit values in 4 KB pages, a page is only allocated once one of its slots is written
+	// pages that were never written all point at one shared, read only page of npos
+	struct PagedSparseIndex {
+		static constexpr size_t PageBits = 10;
+		static constexpr size_t PageSize = size_t(1) << PageBits;				// entries per page (4 KB of uint32_t)
+		static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+		using Page = std::array<uint32_t, PageSize>;
+
+		inline static const Page emptyPage = [] { Page page; page.fill(npos); return page; }();
+
+		std::vector<const Page*> pages;											// emptyPage or a page owned by this index
+
+		PagedSparseIndex() = default;
+		PagedSparseIndex(const PagedSparseIndex& other) { *this = other; }
+		PagedSparseIndex(PagedSparseIndex&& other) : pages(std::move(other.pages)) { other.pages.clear(); }
+		PagedSparseIndex& operator=(const PagedSparseIndex& other) {
+			if(this == &other) return *this;
+			Clear();
+			for(auto page: other.pages)
+				pages.push_back(page == &emptyPage ? &emptyPage : new Page(*page));
+			return *this;
+		}
+		PagedSparseIndex& operator=(PagedSparseIndex&& other) { std::swap(pages, other.pages); return *this; }
+		~PagedSparseIndex() { Clear(); }
+
+		uint32_t Get(size_t index) const {
+			size_t page = index >> PageBits;
+			return page < pages.size() ? (*pages[page])[index & (PageSize - 1)] : npos;
+		}
+
+		void Set(size_t index, uint32_t value) {
+			size_t page = index >> PageBits;
+			if(pages.size() <= page)
+				pages.resize(page + 1, &emptyPage);
+			if(pages[page] == &emptyPage) {
+				if(value == npos) return;											// nothing to clear in a page that was never written
+				pages[page] = new Page(emptyPage);
+			}
+			const_cast<Page&>(*pages[page])[index & (PageSize - 1)] = value;		// only pages owned by this index are ever written
+		}
+
+		size_t AllocatedPages() const { return std::count_if(pages.begin(), pages.end(), [](const Page* page) { return page != &emptyPage; }); }
+		size_t MemoryBytes() const { return pages.capacity() * sizeof(const Page*) + AllocatedPages() * sizeof(Page); }
+
+		void Clear() {
+			for(auto page: pages)
+				if(page != &emptyPage) delete page;
+			pages.clear();
+		}
+	};
+
 	struct SkiplistComponentStorage {	// manages the storage of components in a skiplist-like structure
 		size_t elementSize = -1;		// size of a single component in bytes; initialized to -1 which acts like an invalid or unintialized state value
-		std::vector<size_t> indecies;	// vector that stores the index of each entity's component in the data vector
+		PagedSparseIndex indecies;		// index of each entity's component in the data vector; pages are only allocated around entities that have the component
 		std::vector<std::byte> data;	// vector that stores all component data for all entities
 
 		// default constructor
-		// initializes elementSize to -1, indecies to a vector of size 1 with value -1, and data to a vector of size 1 with value 0
-		SkiplistComponentStorage() : elementSize(-1), indecies(1, -1), data(1, std::byte{0}) {}
+		// initializes elementSize to -1, and data to a vector of size 1 with value 0
+		SkiplistComponentStorage() : elementSize(-1), data(1, std::byte{0}) {}
 
 		// constructor with known element size; reserves space for 5 components
 		SkiplistComponentStorage(size_t elementSize) : elementSize(elementSize) { data.reserve(5 * elementSize); }
@@ -168,11 +1005,19 @@ namespace cs381 {
 		template<typename Tcomponent>
 		Tcomponent& Get(Entity e) {
 			assert(sizeof(Tcomponent) == elementSize);					// ensures size of component matches the elementSize
-			assert(e < indecies.size());								// ensures the entity index is within bounds 
-			assert(indecies[e] != std::numeric_limits<size_t>::max());	// ensures the entity has a valid index in the data vector
-			return *(Tcomponent*)(data.data() + indecies[e]);			// returns deference pointer to get a reference to the component
+			uint32_t index = indecies.Get(e);
+			assert(index != PagedSparseIndex::npos);					// ensures the entity has a valid index in the data vector
+			return *(Tcomponent*)(data.data() + index * elementSize);	// returns deference pointer to get a reference to the component
 																		// 		data.data() gives pointer to the byte array
-																		// 		indecies[e] moves that pointer forward to the e-th component
+																		// 		index * elementSize moves that pointer forward to the entity's component
+		}
+
+		template<typename Tcomponent>
+		const Tcomponent& Get(Entity e) const {
+			assert(sizeof(Tcomponent) == elementSize);
+			uint32_t index = indecies.Get(e);
+			assert(index != PagedSparseIndex::npos);
+			return *(const Tcomponent*)(data.data() + index * elementSize);
 		}
 
 		template<typename Tcomponent>
@@ -188,21 +1033,711 @@ namespace cs381 {
 		template<typename Tcomponent>
 		Tcomponent& Allocate(Entity e) {				// allocates new component of type Tcomponent for the entity e
 			auto [ret, i] = Allocate<Tcomponent>(); 	// calls the previous Allocate<Tcomponent>() function that returns a pair: reference to new component (ret) and the index of the it (i)
-			indecies[e] = i * elementSize;				// sets the index of the entity e in indecies to the index of the new component multiplied by elementSize to get the byte offset
+			indecies.Set(e, i);							// remembers where the entity's component lives
 			return ret;									// returns the reference to the new component
 		}
 
 		template<typename Tcomponent>
 		Tcomponent& GetOrAllocate(Entity e) {
 			assert(sizeof(Tcomponent) == elementSize);				// ensures size of component matches the elementSize
-			if (indecies.size() <= e)								// checks if the indecies vector has enough space for the entity e
-
-				// resize the indecies vector with enough space for the entity e while initializing the new elements to -1
-				indecies.insert(indecies.end(), std::max<int64_t>(int64_t(e) - indecies.size() + 1, 1), -1);
-			if (indecies[e] == std::numeric_limits<size_t>::max())	// checks if the entity e has a valid index in the data vector
+			if (indecies.Get(e) == PagedSparseIndex::npos)			// checks if the entity e has a valid index in the data vector (missing pages read as npos)
 				return Allocate<Tcomponent>(e);						// if not, allocate a new component of type Tcomponent for the entity e
 			return Get<Tcomponent>(e);								// otherwise, return the reference to the component of type Tcomponent associated with entity e
 		}
+
+		StorageMemory Memory() const { return {data.size() / elementSize, data.capacity(), indecies.MemoryBytes()}; }
+	};
+
+
+	// sparse set: components are packed in a dense array with a parallel dense -> entity array,
+	// and a paged sparse index maps an entity to its position in the dense arrays
+	// removing a component moves the last one into its place, so the dense arrays never contain holes
+	struct SparseSetComponentStorage {
+		size_t elementSize = -1;			// size of a single component in bytes
+		PagedSparseIndex sparse;			// entity slot -> position in dense
+		AlignedVector<std::byte> dense;		// packed component data, 64-byte aligned
+		std::vector<Entity> entities;		// position in dense -> entity slot
+
+		SparseSetComponentStorage() = default;
+		SparseSetComponentStorage(size_t elementSize) : elementSize(elementSize) { dense.reserve(5 * elementSize); }
+
+		// template constructor for type-based initialization
+		template<typename Tcomponent>
+		SparseSetComponentStorage(Tcomponent reference = {}) : SparseSetComponentStorage(sizeof(Tcomponent)) {}
+
+		size_t size() const { return entities.size(); }						// number of live components
+		bool Contains(Entity e) const { return sparse.Get(e) != PagedSparseIndex::npos; }
+
+		template<typename Tcomponent>
+		Tcomponent& Get(Entity e) {
+			assert(sizeof(Tcomponent) == elementSize);
+			uint32_t position = sparse.Get(e);
+			assert(position != PagedSparseIndex::npos);							// ensures the entity has this component
+			return *(Tcomponent*)(dense.data() + position * elementSize);
+		}
+
+		template<typename Tcomponent>
+		const Tcomponent& Get(Entity e) const {
+			assert(sizeof(Tcomponent) == elementSize);
+			uint32_t position = sparse.Get(e);
+			assert(position != PagedSparseIndex::npos);
+			return *(const Tcomponent*)(dense.data() + position * elementSize);
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& GetOrAllocate(Entity e) {
+			assert(sizeof(Tcomponent) == elementSize);
+			if(Contains(e)) return Get<Tcomponent>(e);
+			sparse.Set(e, entities.size());
+			entities.push_back(e);
+			dense.insert(dense.end(), elementSize, std::byte{0});
+			return *new(dense.data() + dense.size() - elementSize) Tcomponent();
+		}
+
+		void Remove(Entity e) {													// swap and pop: the last component takes the removed one's place
+			uint32_t position = sparse.Get(e);
+			if(position == PagedSparseIndex::npos) return;
+			size_t last = entities.size() - 1;
+			if(position != last) {
+				std::memcpy(dense.data() + position * elementSize, dense.data() + last * elementSize, elementSize);
+				entities[position] = entities[last];
+				sparse.Set(entities[position], position);
+			}
+			entities.pop_back();
+			dense.resize(dense.size() - elementSize);
+			sparse.Set(e, PagedSparseIndex::npos);
+		}
+
+		// dense access, position is in [0, size())
+		template<typename Tcomponent>
+		Tcomponent& At(size_t position) { return *(Tcomponent*)(dense.data() + position * elementSize); }
+
+		// every component as a typed array, Entities()[i] is the slot of the entity owning Span<Tcomponent>()[i]
+		template<typename Tcomponent>
+		std::span<Tcomponent> Span() {
+			assert(sizeof(Tcomponent) == elementSize);
+			return {std::assume_aligned<64>((Tcomponent*)dense.data()), entities.size()};
+		}
+
+		std::span<const Entity> Entities() const { return entities; }
+
+		StorageMemory Memory() const { return {entities.size(), dense.capacity(), sparse.MemoryBytes() + entities.capacity() * sizeof(Entity)}; }
+	};
+
+
+	// stores entities grouped by archetype (the exact set of components they have)
+	// every archetype owns fixed-size chunks, and each chunk holds one dense column per component plus a column of entities
+	// rows are packed: every chunk except the last one is full, so iterating a column never hits a hole
+	struct ArchetypeStorage {
+		static constexpr size_t ChunkSize = 16 * 1024;						// bytes per chunk
+		static constexpr size_t ColumnAlignment = 64;						// every column starts on its own cache line
+		static constexpr size_t npos = std::numeric_limits<size_t>::max();	// marks a missing column / an entity without components
+
+		struct ChunkDeleter {
+			void operator()(std::byte* memory) const { ::operator delete[](memory, std::align_val_t{ColumnAlignment}); }
+		};
+		using Chunk = std::unique_ptr<std::byte[], ChunkDeleter>;			// one ChunkSize block of column aligned memory
+
+		struct Archetype {
+			Signature signature;				// signature shared by every entity in this archetype
+			std::array<size_t, MaxComponents> columnOf;	// component ID -> column index, npos if the archetype doesn't store that component
+			std::vector<size_t> elementSizes;	// size of a single element of each column
+			std::vector<size_t> offsets;		// byte offset of each column inside a chunk
+			size_t capacity = 0;				// number of rows that fit in one chunk
+			size_t size = 0;					// number of rows (entities) across all chunks
+			std::vector<Chunk> chunks;
+
+			Archetype() = default;
+			Archetype(Archetype&&) = default;
+			Archetype& operator=(Archetype&&) = default;
+			Archetype(const Archetype& other)						// copies every chunk, see Scene<ArchetypeStorage>::Fork
+				: signature(other.signature), columnOf(other.columnOf), elementSizes(other.elementSizes), offsets(other.offsets), capacity(other.capacity), size(other.size) {
+				for(auto& chunk: other.chunks) {
+					chunks.push_back(AllocateChunk());
+					std::memcpy(chunks.back().get(), chunk.get(), ChunkBytes());
+				}
+			}
+
+			size_t ChunkRows(size_t chunk) const { return std::min(capacity, size - chunk * capacity); }	// number of live rows in a chunk
+			size_t ChunkBytes() const { return std::max(ChunkSize, offsets.empty() ? 0 : offsets.back() + elementSizes.back() * capacity); }	// only a single oversized row spills past ChunkSize
+			Chunk AllocateChunk() const { return Chunk((std::byte*)::operator new[](ChunkBytes(), std::align_val_t{ColumnAlignment})); }
+
+			// entities are stored in the first column of every chunk
+			Entity* Entities(size_t chunk) { return (Entity*)chunks[chunk].get(); }
+
+			std::byte* Column(size_t chunk, size_t column) { return chunks[chunk].get() + offsets[column]; }
+			std::byte* Element(size_t row, size_t column) { return Column(row / capacity, column) + (row % capacity) * elementSizes[column]; }
+			const std::byte* Element(size_t row, size_t column) const { return chunks[row / capacity].get() + offsets[column] + (row % capacity) * elementSizes[column]; }
+		};
+
+		struct Location {
+			size_t archetype = npos;	// index into archetypes, npos while the entity has no components
+			size_t row = 0;				// row inside that archetype
+		};
+
+		std::vector<Archetype> archetypes;							// every archetype ever seen
+		std::map<Signature, size_t> archetypeLookup;				// signature -> index into archetypes
+		std::vector<Location> locations;							// entity slot -> where its components live
+		std::array<size_t, MaxComponents> componentSizes = MakeUnregistered();	// component ID -> element size (0 for tags, npos until the component is first used)
+
+		static std::array<size_t, MaxComponents> MakeUnregistered() { std::array<size_t, MaxComponents> out; out.fill(npos); return out; }
+
+		template<typename Tcomponent>
+		void Register() {												// remembers how large the component is so archetypes can lay out its column
+			componentSizes[GetComponentID<Tcomponent>()] = TagComponent<Tcomponent> ? 0 : sizeof(Tcomponent);
+		}
+
+		size_t GetOrCreateArchetype(Signature signature) {
+			if(auto found = archetypeLookup.find(signature); found != archetypeLookup.end())
+				return found->second;
+
+			Archetype archetype;
+			archetype.signature = signature;
+			archetype.columnOf.fill(npos);
+			size_t rowSize = sizeof(Entity);
+			for(size_t id = 0; id < MaxComponents; id++)
+				if(signature.test(id)) {
+					assert(componentSizes[id] != npos);					// the component must have been registered before it can be stored
+					if(componentSizes[id] == 0) continue;				// tags only live in the signature
+					archetype.columnOf[id] = archetype.elementSizes.size();
+					archetype.elementSizes.push_back(componentSizes[id]);
+					rowSize += componentSizes[id];
+				}
+
+			// leave room for padding every column (including the entity column) up to ColumnAlignment
+			size_t padding = ColumnAlignment * (archetype.elementSizes.size() + 1);
+			archetype.capacity = std::max<size_t>((ChunkSize - std::min(padding, ChunkSize)) / rowSize, 1);
+
+			size_t offset = sizeof(Entity) * archetype.capacity;
+			for(size_t size: archetype.elementSizes) {
+				offset = (offset + ColumnAlignment - 1) / ColumnAlignment * ColumnAlignment;
+				archetype.offsets.push_back(offset);
+				offset += size * archetype.capacity;
+			}
+			assert(offset <= ChunkSize || archetype.capacity == 1);	// only a single oversized row may spill past ChunkSize
+
+			archetypes.push_back(std::move(archetype));
+			return archetypeLookup[signature] = archetypes.size() - 1;
+		}
+
+		size_t Emplace(size_t archetypeIndex, Entity e) {				// appends a row for e to the archetype and returns its index
+			auto& archetype = archetypes[archetypeIndex];
+			size_t row = archetype.size++;
+			if(row / archetype.capacity >= archetype.chunks.size())	// the last chunk is full, start a new one
+				archetype.chunks.push_back(archetype.AllocateChunk());
+			archetype.Entities(row / archetype.capacity)[row % archetype.capacity] = e;
+			return row;
+		}
+
+		void Erase(size_t archetypeIndex, size_t row) {				// removes a row by moving the archetype's last row into it
+			auto& archetype = archetypes[archetypeIndex];
+			size_t last = --archetype.size;
+			if(row != last) {
+				Entity moved = archetype.Entities(last / archetype.capacity)[last % archetype.capacity];
+				archetype.Entities(row / archetype.capacity)[row % archetype.capacity] = moved;
+				for(size_t column = 0; column < archetype.elementSizes.size(); column++)
+					std::memcpy(archetype.Element(row, column), archetype.Element(last, column), archetype.elementSizes[column]);
+				locations[EntityIndex(moved)].row = row;
+			}
+			if(archetype.size <= (archetype.chunks.size() - 1) * archetype.capacity)	// the last chunk is now empty
+				archetype.chunks.pop_back();
+		}
+
+		void Move(Entity e, Signature signature) {						// moves e (and every component it shares with the new signature) into the matching archetype
+			size_t index = EntityIndex(e);
+			if(locations.size() <= index)
+				locations.resize(index + 1);
+			Location from = locations[index];
+			Location to = {npos, 0};
+			if(signature.HasComponents()) {
+				to.archetype = GetOrCreateArchetype(signature);
+				if(to.archetype == from.archetype) return;
+				to.row = Emplace(to.archetype, e);
+			}
+
+			if(from.archetype != npos) {
+				if(to.archetype != npos) {
+					auto& source = archetypes[from.archetype];
+					auto& destination = archetypes[to.archetype];
+					for(size_t id = 0; id < MaxComponents; id++)			// copy every component both archetypes store
+						if(source.columnOf[id] != npos && destination.columnOf[id] != npos)
+							std::memcpy(destination.Element(to.row, destination.columnOf[id]), source.Element(from.row, source.columnOf[id]), source.elementSizes[source.columnOf[id]]);
+				}
+				Erase(from.archetype, from.row);
+			}
+			locations[index] = to;
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& Get(Entity e) {
+			if constexpr (TagComponent<Tcomponent>)
+				return tagInstance<Tcomponent>;
+			else {
+				size_t id = GetComponentID<Tcomponent>();
+				auto& location = locations[EntityIndex(e)];
+				assert(location.archetype != npos);										// ensures the entity has been placed in an archetype
+				auto& archetype = archetypes[location.archetype];
+				assert(archetype.columnOf[id] != npos);									// ensures the archetype stores this component
+				return *(Tcomponent*)archetype.Element(location.row, archetype.columnOf[id]);
+			}
+		}
+
+		template<typename Tcomponent>
+		const Tcomponent& Get(Entity e) const {
+			if constexpr (TagComponent<Tcomponent>)
+				return tagInstance<Tcomponent>;
+			else {
+				size_t id = GetComponentID<Tcomponent>();
+				auto& location = locations[EntityIndex(e)];
+				assert(location.archetype != npos && archetypes[location.archetype].columnOf[id] != npos);
+				auto& archetype = archetypes[location.archetype];
+				return *(const Tcomponent*)archetype.Element(location.row, archetype.columnOf[id]);
+			}
+		}
+	};
+
+	// Scene backed by an ArchetypeStorage, exposes the same interface as the per-component storages
+	template<>
+	struct Scene<ArchetypeStorage> {
+		std::vector<Signature> entityMasks;				// signature of every entity, also the key of the archetype it lives in
+		ArchetypeStorage storage;						// every component of every entity
+		EntityAllocator entities;						// generation of every entity slot plus the free list of destroyed slots
+
+		// archetypes matching a signature; entities never need tracking since they already live grouped by archetype
+		struct QueryCache {
+			Signature required;
+			std::vector<size_t> archetypes;				// indices of the matching archetypes
+			size_t checked = 0;							// archetypes [0, checked) have already been tested
+			std::vector<std::pair<uint64_t, uint32_t>> lastRuns;	// filter list hash -> tick its last filtered ForEach started at
+
+			void Refresh(ArchetypeStorage& storage) {	// picks up archetypes created since the last refresh
+				for(; checked < storage.archetypes.size(); checked++)
+					if(storage.archetypes[checked].signature.Contains(required))
+						archetypes.push_back(checked);
+			}
+		};
+		std::deque<QueryCache> queries;
+		CopyableMutex queryMutex;
+		ChangeTracker changes;							// when each component was added and last changed, for Changed/Added filters
+
+		template<typename... Tcomponents>
+		struct Query {
+			Scene* scene;
+			QueryCache* cache;
+
+			size_t size() const {
+				cache->Refresh(scene->storage);
+				size_t out = 0;
+				for(size_t archetype: cache->archetypes)
+					out += scene->storage.archetypes[archetype].size;
+				return out;
+			}
+
+			template<typename... Tfilters, typename F>
+			void ForEach(F&& fn) {
+				if constexpr (sizeof...(Tfilters) > 0) {
+					auto filtered = scene->changes.template Filter<Tfilters...>(scene->changes.template Begin<Tfilters...>(cache->lastRuns, scene->queryMutex), fn);
+					return ForEach(filtered);
+				}
+				cache->Refresh(scene->storage);
+				for(size_t archetype: cache->archetypes)
+					if(!scene->template ForEachIn<Tcomponents...>(scene->storage.archetypes[archetype], fn)) return;
+			}
+
+			// calls fn(entity, components...) for every matching entity, one job per chunk
+			// fn runs concurrently so it may only touch the components it is given (and other data it synchronizes itself)
+			template<typename... Tfilters, typename F>
+			void ParallelForEach(F&& fn, JobSystem& jobs = JobSystem::Default()) {
+				if constexpr (sizeof...(Tfilters) > 0) {
+					auto filtered = scene->changes.template Filter<Tfilters...>(scene->changes.template Begin<Tfilters...>(cache->lastRuns, scene->queryMutex), fn);
+					return ParallelForEach(filtered, jobs);
+				}
+				cache->Refresh(scene->storage);
+				std::vector<std::pair<ArchetypeStorage::Archetype*, size_t>> chunks;
+				for(size_t archetype: cache->archetypes)
+					for(size_t chunk = 0; chunk < scene->storage.archetypes[archetype].chunks.size(); chunk++)
+						chunks.emplace_back(&scene->storage.archetypes[archetype], chunk);
+				jobs.ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+					for(size_t i = begin; i < end; i++)
+						scene->template ForEachInChunk<Tcomponents...>(*chunks[i].first, chunks[i].second, fn);
+				});
+			}
+		};
+
+		template<typename... Tcomponents>
+		Query<Tcomponents...> GetQuery() {
+			constexpr Signature required = MakeSignature<Tcomponents...>();
+			std::scoped_lock lock(queryMutex);
+			for(auto& query: queries)
+				if(query.required == required)
+					return {this, &query};
+			auto& query = queries.emplace_back();
+			query.required = required;
+			return {this, &query};
+		}
+
+		Entity CreateEntity() {
+			auto [e, recycled] = entities.Create();
+			if(recycled)
+				entityMasks[EntityIndex(e)] = Signature::Alive();
+			else {
+				entityMasks.push_back(Signature::Alive());
+				storage.locations.emplace_back();		// no components yet, so not in any archetype
+			}
+			return e;
+		}
+
+		void DestroyEntity(Entity e) {
+			if(!IsAlive(e)) return;
+			entityMasks[EntityIndex(e)] = {};
+			storage.Move(e, {});						// drops the entity's row from its archetype
+			entities.Destroy(e);
+		}
+
+		bool IsAlive(Entity e) const { return entities.IsAlive(e); }
+
+		Entity GetEntity(size_t index) const { return entities.Get(index); }
+
+		// copy of the scene to simulate ahead with and throw away, every chunk is copied (change ticks are shared until stamped)
+		Scene Fork() const { return *this; }
+
+		template<typename... Tcomponents>
+		static constexpr std::array<size_t, sizeof...(Tcomponents)> ElementSizes(ComponentList<Tcomponents...>) { return {(TagComponent<Tcomponents> ? 0 : sizeof(Tcomponents))...}; }
+
+		// a component's stored slots are the rows of every chunk of the archetypes holding it, so unused rows at the end of chunks count as fragmentation
+		// element sizes come from the registry, so a component no archetype holds yet reports its size like it does with the other storages
+		template<typename Dependent = void>							// a template so the registry is only looked up once Stats is used
+		SceneStats Stats() const {
+			constexpr auto& names = RegisteredComponents<Dependent>::names;
+			constexpr auto sizes = ElementSizes(RegisteredComponents<Dependent>{});
+			auto live = CountComponents(entityMasks);
+			std::vector<StorageMemory> memory(names.size());
+			SceneStats out;
+			for(auto& archetype: storage.archetypes) {
+				size_t rows = archetype.chunks.size() * archetype.capacity;
+				for(size_t id = 0; id < names.size(); id++)
+					if(size_t column = archetype.columnOf[id]; column != ArchetypeStorage::npos) {
+						memory[id].stored += rows;
+						memory[id].capacityBytes += rows * archetype.elementSizes[column];
+					}
+				out.indexBytes += rows * sizeof(Entity) + sizeof(archetype) + archetype.chunks.capacity() * sizeof(ArchetypeStorage::Chunk);	// entity column and bookkeeping
+			}
+			out.indexBytes += storage.locations.capacity() * sizeof(ArchetypeStorage::Location) + storage.archetypeLookup.size() * (sizeof(std::pair<const Signature, size_t>) + 4 * sizeof(void*));
+			out.components.resize(names.size());
+			for(size_t id = 0; id < names.size(); id++) {
+				auto& stats = out.components[id];
+				stats.name = names[id];
+				stats.live = live[id];
+				if(sizes[id] != 0)										// tags have no column
+					FillComponentStats(stats, sizes[id], memory[id]);
+			}
+			out.entities = live[Signature::AliveBit];
+			out.slots = entityMasks.size();
+			out.freeSlots = entities.freeList.size();
+			out.maskBytes = entityMasks.capacity() * sizeof(Signature);
+			out.entityBytes = entities.generations.capacity() * sizeof(Entity) + entities.freeList.capacity() * sizeof(size_t);
+			for(auto& query: queries)
+				out.queryBytes += sizeof(QueryCache) + query.archetypes.capacity() * sizeof(size_t) + query.lastRuns.capacity() * sizeof(query.lastRuns[0]);
+			StorageMemory ticks = changes.Memory();
+			out.changeBytes = ticks.capacityBytes;
+			out.changeSharedBytes = ticks.sharedBytes;
+			return out;
+		}
+
+		template<typename... Tcomponents, typename F>
+		std::vector<Entity> Spawn(size_t count, F&& init) {	// entities go straight into their final archetype, without passing through the intermediate ones
+			constexpr Signature signature = MakeSignature<Tcomponents...>();
+			(storage.Register<Tcomponents>(), ...);
+			std::vector<Entity> spawned(count);
+			size_t slots = entityMasks.size();
+			for(auto& e: spawned) {
+				e = entities.Create().first;
+				slots = std::max(slots, EntityIndex(e) + 1);
+			}
+			entityMasks.resize(slots);
+			storage.locations.resize(slots);
+			(changes.Reserve(GetComponentID<Tcomponents>(), slots), ...);
+			for(size_t i = 0; i < count; i++) {
+				Entity e = spawned[i];
+				entityMasks[EntityIndex(e)] = signature;
+				storage.Move(e, signature);
+				(changes.MarkAdded(GetComponentID<Tcomponents>(), EntityIndex(e)), ...);
+				init(i, e, *new(&storage.Get<Tcomponents>(e)) Tcomponents()...);
+			}
+			return spawned;
+		}
+
+		template<typename... Tcomponents, typename F>
+		std::vector<Entity> Spawn(const Prefab<Tcomponents...>& prefab, size_t count, F&& init) {
+			return Spawn<Tcomponents...>(count, [&](size_t i, Entity e, Tcomponents&... components) {
+				((components = std::get<Tcomponents>(prefab.components)), ...);
+				init(i, e, components...);
+			});
+		}
+
+		template<typename... Tcomponents>
+		std::vector<Entity> Spawn(const Prefab<Tcomponents...>& prefab, size_t count) {
+			return Spawn(prefab, count, [](size_t, Entity, Tcomponents&...) {});
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& AddComponent(Entity e) {
+			assert(IsAlive(e));
+			if(HasComponent<Tcomponent>(e))
+				return GetMutable<Tcomponent>(e);
+
+			auto& eMask = entityMasks[EntityIndex(e)];
+			eMask.set(GetComponentID<Tcomponent>());
+			changes.MarkAdded(GetComponentID<Tcomponent>(), EntityIndex(e));
+			storage.Register<Tcomponent>();
+			storage.Move(e, eMask);										// migrate the entity into the archetype that includes the new component
+			return *new(&storage.Get<Tcomponent>(e)) Tcomponent();		// the new column slot is uninitialized, construct the component in it
+		}
+
+		template<typename Tcomponent>
+		void RemoveComponent(Entity e) {
+			if(!HasComponent<Tcomponent>(e)) return;
+			auto& eMask = entityMasks[EntityIndex(e)];
+			eMask.reset(GetComponentID<Tcomponent>());
+			storage.Move(e, eMask);										// migrate the entity into the archetype without the component
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& GetComponent(Entity e) {
+			assert(HasComponent<Tcomponent>(e));
+			return storage.Get<Tcomponent>(e);
+		}
+
+		template<typename Tcomponent>
+		Tcomponent& GetMutable(Entity e) {
+			MarkChanged<Tcomponent>(e);
+			return GetComponent<Tcomponent>(e);
+		}
+
+		template<typename Tcomponent>
+		void MarkChanged(Entity e) {
+			assert(HasComponent<Tcomponent>(e));
+			changes.MarkChanged(GetComponentID<Tcomponent>(), EntityIndex(e));
+		}
+
+		template<typename Tcomponent>
+		bool HasComponent(Entity e) const {
+			return IsAlive(e) && entityMasks[EntityIndex(e)].test(GetComponentID<Tcomponent>());
+		}
+
+		// unchecked access by slot index, for callers that already matched the signature (e.g. Pipeline), a const Tcomponent is only read
+		template<typename Tcomponent>
+		Tcomponent& GetComponentAt(size_t index) {
+			if constexpr (std::is_const_v<Tcomponent>)
+				return std::as_const(*this).template GetComponentAt<std::remove_const_t<Tcomponent>>(index);
+			else return storage.Get<Tcomponent>(Entity(index));			// the storage only looks at the slot of the handle
+		}
+
+		template<typename Tcomponent>
+		const Tcomponent& GetComponentAt(size_t index) const { return storage.Get<Tcomponent>(Entity(index)); }
+
+		// calls fn(entity, components...) chunk by chunk for every archetype that has ALL of Tcomponents
+		// fn may return false to stop the iteration early, but must not add or remove components while iterating
+		template<typename... Tcomponents, typename F>
+		void ForEach(F&& fn) {
+			Signature required = MakeSignature<Tcomponents...>();
+			for(auto& archetype: storage.archetypes)
+				if(archetype.signature.Contains(required) && !ForEachIn<Tcomponents...>(archetype, fn))
+					return;
+		}
+
+		template<typename... Tcomponents, typename F>
+		bool ForEachIn(ArchetypeStorage::Archetype& archetype, F& fn) {	// walks every chunk of one archetype, returns false if fn asked to stop
+			for(size_t chunk = 0; chunk < archetype.chunks.size(); chunk++)
+				if(!ForEachInChunk<Tcomponents...>(archetype, chunk, fn)) return false;
+			return true;
+		}
+
+		template<typename... Tcomponents, typename F>
+		bool ForEachInChunk(ArchetypeStorage::Archetype& archetype, size_t chunk, F& fn) {	// walks the rows of one chunk, returns false if fn asked to stop
+			Entity* entities = archetype.Entities(chunk);
+			std::tuple<Tcomponents*...> columns = {Column<Tcomponents>(archetype, chunk)...};
+			size_t rows = archetype.ChunkRows(chunk);
+			for(size_t row = 0; row < rows; row++)
+				if constexpr (std::is_same_v<std::invoke_result_t<F, Entity, Tcomponents&...>, bool>) {
+					if(!fn(entities[row], Row(std::get<Tcomponents*>(columns), row)...)) return false;
+				} else fn(entities[row], Row(std::get<Tcomponents*>(columns), row)...);
+			return true;
+		}
+
+	private:
+		template<typename Tcomponent>
+		static Tcomponent* Column(ArchetypeStorage::Archetype& archetype, size_t chunk) {	// start of a component's column in a chunk (the shared instance for tags)
+			if constexpr (TagComponent<Tcomponent>)
+				return &tagInstance<Tcomponent>;
+			else return (Tcomponent*)archetype.Column(chunk, archetype.columnOf[GetComponentID<Tcomponent>()]);
+		}
+
+		template<typename Tcomponent>
+		static Tcomponent& Row(Tcomponent* column, size_t row) {
+			if constexpr (TagComponent<Tcomponent>)
+				return *column;
+			else return column[row];
+		}
+	};
+
+
+	// records structural changes (and component writes) while systems run, so nothing reallocates under references they hold
+	// recorded commands are applied in one batch by Playback at a sync point, when no system is running
+	// a buffer must only be used by one thread at a time, CommandBuffers hands out one per thread
+	// component values are stored as raw bytes, so like snapshots the buffer only takes trivially copyable components
+	template<typename Tscene>
+	struct CommandBuffer {
+		struct Pending { uint32_t index; };					// an entity created by this buffer, it gets a real handle during playback
+
+		struct Target {										// an existing entity or one created by this buffer
+			uint32_t id;
+			bool pending;
+			Target(Entity e) : id(e), pending(false) {}
+			Target(Pending p) : id(p.index), pending(true) {}
+		};
+
+		struct Command {
+			Target target;
+			uint32_t component;								// ID of the component the command touches, commands are sorted by it during playback
+			size_t payload;									// offset of the component value in payloads
+			void(*apply)(Tscene&, Entity, std::byte*);		// performs the command and destroys its payload
+			void(*discard)(std::byte*);						// destroys the payload of a command that never gets applied
+		};
+
+		uint32_t created = 0;								// entities to create
+		std::vector<Command> commands;
+		std::vector<Target> destroyed;
+		std::vector<std::byte> payloads;					// component values, packed
+
+		Pending CreateEntity() { return {created++}; }
+
+		void DestroyEntity(Target e) { destroyed.push_back(e); }
+
+		// adds the component (value initialized unless a value is given), like Scene::AddComponent an existing component is overwritten
+		template<typename Tcomponent>
+		void AddComponent(Target e, Tcomponent value = {}) {
+			Record<Tcomponent>(e, std::move(value), [](Tscene& scene, Entity e, std::byte* payload) {
+				Tcomponent& value = *(Tcomponent*)payload;
+				if constexpr (TagComponent<Tcomponent>)
+					scene.template AddComponent<Tcomponent>(e);
+				else scene.template AddComponent<Tcomponent>(e) = std::move(value);
+				value.~Tcomponent();
+			});
+		}
+
+		template<typename Tcomponent>
+		void RemoveComponent(Target e) {
+			Record<Tcomponent>(e, std::nullopt, [](Tscene& scene, Entity e, std::byte*) {
+				scene.template RemoveComponent<Tcomponent>(e);
+			});
+		}
+
+		// overwrites the component if the entity still has it at playback, does nothing otherwise
+		// the write is stamped like GetMutable's, so Changed<Tcomponent> filters see it
+		template<typename Tcomponent>
+		void SetComponent(Target e, Tcomponent value) {
+			Record<Tcomponent>(e, std::move(value), [](Tscene& scene, Entity e, std::byte* payload) {
+				Tcomponent& value = *(Tcomponent*)payload;
+				if(scene.template HasComponent<Tcomponent>(e))
+					scene.template GetMutable<Tcomponent>(e) = std::move(value);
+				value.~Tcomponent();
+			});
+		}
+
+		bool empty() const { return created == 0 && commands.empty() && destroyed.empty(); }
+
+		// applies every recorded command to scene and clears the buffer, returns the handles of the created entities (indexed by Pending::index)
+		std::vector<Entity> Playback(Tscene& scene) {
+			CommandBuffer* self = this;
+			return std::move(Playback(scene, {&self, 1})[0]);
+		}
+
+		// applies several buffers in one batch: entities are created first, then component commands grouped by storage, then destructions
+		// commands of one buffer touching the same component of the same entity keep the order they were recorded in
+		static std::vector<std::vector<Entity>> Playback(Tscene& scene, std::span<CommandBuffer*> buffers) {
+			std::vector<std::vector<Entity>> handles(buffers.size());
+			size_t total = 0;
+			for(size_t b = 0; b < buffers.size(); b++) {
+				for(uint32_t i = 0; i < buffers[b]->created; i++)
+					handles[b].push_back(scene.CreateEntity());
+				total += buffers[b]->commands.size();
+			}
+			auto resolve = [&](size_t b, Target target) { return target.pending ? handles[b][target.id] : Entity(target.id); };
+
+			struct Resolved { Entity e; uint32_t component; Command* command; std::byte* payload; };
+			std::vector<Resolved> order;
+			order.reserve(total);
+			for(size_t b = 0; b < buffers.size(); b++)
+				for(auto& command: buffers[b]->commands)
+					order.push_back({resolve(b, command.target), command.component, &command, buffers[b]->payloads.data() + command.payload});
+			std::stable_sort(order.begin(), order.end(), [](const Resolved& a, const Resolved& b) {	// one storage at a time, walking it in slot order
+				return a.component != b.component ? a.component < b.component : EntityIndex(a.e) < EntityIndex(b.e);
+			});
+			for(auto& resolved: order)
+				if(scene.IsAlive(resolved.e))
+					resolved.command->apply(scene, resolved.e, resolved.payload);
+				else resolved.command->discard(resolved.payload);
+
+			for(size_t b = 0; b < buffers.size(); b++)
+				for(Target target: buffers[b]->destroyed)
+					scene.DestroyEntity(resolve(b, target));
+
+			for(auto buffer: buffers) {
+				buffer->created = 0;
+				buffer->commands.clear();
+				buffer->destroyed.clear();
+				buffer->payloads.clear();
+			}
+			return handles;
+		}
+
+		CommandBuffer() = default;
+		CommandBuffer(const CommandBuffer&) = delete;		// payloads hold live objects
+		~CommandBuffer() {
+			for(auto& command: commands)
+				command.discard(payloads.data() + command.payload);
+		}
+
+	private:
+		template<typename Tcomponent, typename Tvalue>
+		void Record(Target e, Tvalue&& value, void(*apply)(Tscene&, Entity, std::byte*)) {
+			static_assert(alignof(Tcomponent) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "payloads are only aligned to the default new alignment");
+			size_t payload = payloads.size();
+			void(*discard)(std::byte*) = [](std::byte*) {};
+			if constexpr (!std::is_same_v<std::remove_cvref_t<Tvalue>, std::nullopt_t>) {
+				static_assert(std::is_trivially_copyable_v<Tcomponent>, "payloads are relocated as raw bytes when the buffer grows");
+				payload = (payloads.size() + alignof(Tcomponent) - 1) / alignof(Tcomponent) * alignof(Tcomponent);
+				payloads.resize(payload + sizeof(Tcomponent));		// may move earlier payloads, which is fine for trivially copyable ones
+				new(payloads.data() + payload) Tcomponent(std::move(value));
+				discard = [](std::byte* payload) { ((Tcomponent*)payload)->~Tcomponent(); };
+			}
+			commands.push_back({e, (uint32_t)GetComponentID<Tcomponent>(), payload, apply, discard});
+		}
+	};
+
+	// one CommandBuffer per thread, so systems running in parallel can record without locking each other
+	template<typename Tscene>
+	struct CommandBuffers {
+		std::mutex mutex;
+		std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer<Tscene>>>> buffers;
+
+		CommandBuffer<Tscene>& Local() {					// the calling thread's buffer, fetch it once per system rather than once per command
+			std::scoped_lock lock(mutex);
+			for(auto& [thread, buffer]: buffers)
+				if(thread == std::this_thread::get_id())
+					return *buffer;
+			return *buffers.emplace_back(std::this_thread::get_id(), std::make_unique<CommandBuffer<Tscene>>()).second;
+		}
+
+		// applies every thread's commands in one batch, must only be called while no system is recording
+		void Playback(Tscene& scene) {
+			std::vector<CommandBuffer<Tscene>*> pending;
+			for(auto& [thread, buffer]: buffers)
+				if(!buffer->empty()) pending.push_back(buffer.get());
+			if(!pending.empty())
+				CommandBuffer<Tscene>::Playback(scene, pending);
+		}
 	};
 
 
@@ -215,20 +1750,22 @@ namespace cs381 {
 		struct Sentinel {};							// empty struct used to mark the end of the iteration range
 		struct Iterator {							// struct that represents an interator over the entities in the scene
 			Scene<SkiplistComponentStorage>* scene = nullptr;	// pointer to the scene object
-			Entity e;											// current entity index
+			size_t index;										// current entity slot
+
+			Entity entity() { return scene->GetEntity(index); }	// handle of the entity in the current slot
 
-			// bool function that checks if the current entity e has ALL the components specified in Tcomponents
-			bool valid() { return (scene->HasComponent<Tcomponents>(e) && ...); }
+			// bool function that checks if the current entity has ALL the components specified in Tcomponents
+			bool valid() { return (scene->template HasComponent<Tcomponents>(entity()) && ...); }
 
 			// this operator checks if the iterator has reached the end of the scene
-			// if the scene is null or the entity index e exceeds or equal to the # of entities, it means it has reached the end of the iteration
-			bool operator==(Sentinel) { return scene == nullptr || e >= scene->entityMasks.size(); }
+			// if the scene is null or the slot index exceeds or equal to the # of entities, it means it has reached the end of the iteration
+			bool operator==(Sentinel) { return scene == nullptr || index >= scene->entityMasks.size(); }
 
 			Iterator& operator++(post_increment_t) { 					// post-increment operator
 				do {
-					e++;												// increments the entity index e
-				} while(!valid() && e < scene->entityMasks.size());		// checks if the current entity e has all the components specified in Tcomponents
-																		// checks if current entity index e is within the bounds of the entityMasks vector
+					index++;											// increments the slot index
+				} while(index < scene->entityMasks.size() && !valid());	// checks if current slot index is within the bounds of the entityMasks vector
+																		// checks if the current entity has all the components specified in Tcomponents
 				return *this;											// returns the iterator object
 			}
 
@@ -239,17 +1776,17 @@ namespace cs381 {
 				return old;					// returns the old iterator object
 			}
 
-			// Entity operator*() { return e; }
+			// Entity operator*() { return entity(); }
 
-			// dereference returns a tuple of references to the components of the current entity e
-			std::tuple<std::add_lvalue_reference_t<Tcomponents>...> operator*() { return { scene->GetComponent<Tcomponents>(e)... }; }
+			// dereference returns a tuple of references to the components of the current entity
+			std::tuple<std::add_lvalue_reference_t<Tcomponents>...> operator*() { return { scene->template GetComponent<Tcomponents>(entity())... }; }
 		};
 
 		Iterator begin() { 
 			Iterator out{&scene, 0}; 		// creates new iterator obeject out
 											// &scene is the iterator pointer to the scene object
 											// 0 is the starting entity index
-			if(!out.valid()) ++out;			// checks if the current entity e has all the components specified in Tcomponents
+			if(out.index < scene.entityMasks.size() && !out.valid()) ++out;			// checks if the current entity e has all the components specified in Tcomponents
 											// if so, it increments the entity index e to the next valid entity
 			return out;						// return the first valid iterator
 		}
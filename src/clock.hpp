@@ -0,0 +1,40 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace cs381 {
+
+	// fixed timestep simulation clock: frame times are added to an accumulator which is spent in whole ticks of the same length,
+	// so the simulation gives the same results at any frame rate; what is left over (Alpha) tells rendering how far to interpolate between the last two ticks
+	struct FixedClock {
+		double step;							// seconds per tick
+		size_t maxSteps;						// most ticks run for a single frame, time past that is dropped so one hitch can't snowball
+		double accumulator = 0;					// time not yet simulated, less than one step after Advance
+		uint64_t ticks = 0;						// ticks run so far
+		double dropped = 0;						// time thrown away by the catch-up cap
+
+		FixedClock(double rate = 120, size_t maxSteps = 8) : step(1 / rate), maxSteps(maxSteps) {}
+
+		// adds a frame's worth of time and returns the number of ticks to run for it
+		size_t Advance(double frameTime) {
+			accumulator += std::max(frameTime, 0.0);
+			size_t steps = size_t(accumulator / step);
+			accumulator -= steps * step;
+			if(steps > maxSteps) {
+				dropped += (steps - maxSteps) * step;
+				steps = maxSteps;
+			}
+			ticks += steps;
+			return steps;
+		}
+
+		float Step() const { return float(step); }
+		float Alpha() const { return float(std::clamp(accumulator / step, 0.0, 1.0)); }	// 0 at the last tick, approaching 1 as the next one is due
+		double Time() const { return ticks * step; }													// simulated seconds
+	};
+}
+
+#endif // CLOCK_HPP
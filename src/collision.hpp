@@ -0,0 +1,160 @@
+#ifndef COLLISION_HPP
+#define COLLISION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+#include "jobs.hpp"
+
+namespace cs381 {
+
+	// rectangle on the XZ plane: its center, unit forward axis, and half extents along forward and along the side axis (forward turned 90 degrees)
+	struct OrientedBox {
+		float x, z;
+		float forwardX, forwardZ;
+		float halfLength, halfWidth;
+	};
+
+	// separating axis test between two boxes; when they overlap, fills the axis of least penetration (pointing from a to b) and the depth along it
+	inline bool BoxesOverlap(const OrientedBox& a, const OrientedBox& b, float& normalX, float& normalZ, float& depth) {
+		const float axes[4][2] = {{a.forwardX, a.forwardZ}, {a.forwardZ, -a.forwardX}, {b.forwardX, b.forwardZ}, {b.forwardZ, -b.forwardX}};
+		float dx = b.x - a.x, dz = b.z - a.z;
+		depth = INFINITY;
+		for(auto [lx, lz]: axes) {
+			auto radius = [&](const OrientedBox& box) {						// half the box's shadow on the axis
+				return box.halfLength * std::abs(box.forwardX * lx + box.forwardZ * lz) + box.halfWidth * std::abs(box.forwardZ * lx - box.forwardX * lz);
+			};
+			float distance = dx * lx + dz * lz;
+			float overlap = radius(a) + radius(b) - std::abs(distance);
+			if(overlap < 0) return false;
+			if(overlap < depth) {
+				depth = overlap;
+				normalX = distance < 0 ? -lx : lx;
+				normalZ = distance < 0 ? -lz : lz;
+			}
+		}
+		return true;
+	}
+
+	struct ContactBody {
+		float velocityX, velocityZ;
+		float inverseMass;													// 0 for bodies nothing can push
+		float correctionX = 0, correctionZ = 0;								// how far the solver moves the body to undo penetration
+	};
+
+	struct Contact {
+		uint32_t a, b;														// indices of the bodies
+		float normalX, normalZ;												// unit, from a to b
+		float depth;
+		float bias = 0;														// normal velocity the solver aims for, the bounce
+		float impulse = 0;													// accumulated over the solver's iterations
+	};
+
+	struct ContactSettings {
+		int iterations = 8;
+		float restitution = 0.3f;
+		float bounceThreshold = 1;											// slower impacts don't bounce, which keeps resting contacts from jittering
+		float slop = 0.05f;													// penetration left alone, so touching bodies stay in contact from tick to tick
+		float correction = 0.5f;											// share of the remaining penetration undone per tick
+	};
+
+	// sequential impulses along the contact normals; bodies only get linear responses, nothing spins
+	// touches only the bodies the contacts name, so islands that share no body can be solved at the same time
+	inline void SolveContacts(std::span<Contact> contacts, std::span<ContactBody> bodies, const ContactSettings& settings) {
+		for(auto& contact: contacts) {
+			auto& a = bodies[contact.a];
+			auto& b = bodies[contact.b];
+			float approach = (b.velocityX - a.velocityX) * contact.normalX + (b.velocityZ - a.velocityZ) * contact.normalZ;
+			contact.bias = approach < -settings.bounceThreshold ? -settings.restitution * approach : 0;
+			contact.impulse = 0;
+		}
+		for(int iteration = 0; iteration < settings.iterations; iteration++)
+			for(auto& contact: contacts) {
+				auto& a = bodies[contact.a];
+				auto& b = bodies[contact.b];
+				float inverseMass = a.inverseMass + b.inverseMass;
+				if(inverseMass == 0) continue;
+				float normalVelocity = (b.velocityX - a.velocityX) * contact.normalX + (b.velocityZ - a.velocityZ) * contact.normalZ;
+				float impulse = (contact.bias - normalVelocity) / inverseMass;
+				float total = std::max(contact.impulse + impulse, 0.0f);		// contacts push, never pull
+				impulse = total - contact.impulse;
+				contact.impulse = total;
+				a.velocityX -= contact.normalX * impulse * a.inverseMass;
+				a.velocityZ -= contact.normalZ * impulse * a.inverseMass;
+				b.velocityX += contact.normalX * impulse * b.inverseMass;
+				b.velocityZ += contact.normalZ * impulse * b.inverseMass;
+			}
+		for(auto& contact: contacts) {
+			auto& a = bodies[contact.a];
+			auto& b = bodies[contact.b];
+			float inverseMass = a.inverseMass + b.inverseMass;
+			if(inverseMass == 0) continue;
+			float push = std::max(contact.depth - settings.slop, 0.0f) * settings.correction / inverseMass;
+			a.correctionX -= contact.normalX * push * a.inverseMass;
+			a.correctionZ -= contact.normalZ * push * a.inverseMass;
+			b.correctionX += contact.normalX * push * b.inverseMass;
+			b.correctionZ += contact.normalZ * push * b.inverseMass;
+		}
+	}
+
+	// splits contacts into islands, groups of contacts linked through shared bodies; no body is in two islands, so islands can be solved in parallel
+	// Build reorders the contacts so every island is contiguous, islands are numbered by their first contact and keep their contacts' order
+	struct ContactIslands {
+		std::vector<uint32_t> parent;										// union-find forest over the bodies
+		std::vector<uint32_t> islandOf;										// island of each union-find root
+		std::vector<uint32_t> start;										// island i holds contacts [start[i], start[i + 1])
+		std::vector<Contact> sorted;
+
+		size_t Count() const { return start.empty() ? 0 : start.size() - 1; }
+
+		void Build(std::vector<Contact>& contacts, size_t bodyCount) {
+			parent.resize(bodyCount);
+			std::iota(parent.begin(), parent.end(), 0);
+			for(auto& contact: contacts) {
+				uint32_t a = Find(contact.a), b = Find(contact.b);
+				if(a != b) parent[std::max(a, b)] = std::min(a, b);
+			}
+
+			constexpr uint32_t None = ~uint32_t(0);
+			islandOf.assign(bodyCount, None);
+			start.assign(1, 0);
+			std::vector<uint32_t> counts;
+			for(auto& contact: contacts) {
+				uint32_t& island = islandOf[Find(contact.a)];
+				if(island == None) {
+					island = counts.size();
+					counts.push_back(0);
+				}
+				counts[island]++;
+			}
+			for(uint32_t count: counts)
+				start.push_back(start.back() + count);
+
+			std::vector<uint32_t> next(start.begin(), start.end() - 1);			// counting sort by island
+			sorted.resize(contacts.size());
+			for(auto& contact: contacts)
+				sorted[next[islandOf[Find(contact.a)]]++] = contact;
+			contacts.swap(sorted);
+		}
+
+		// solves every island of contacts (as laid out by Build) over the job system, grain islands per job
+		void Solve(std::span<Contact> contacts, std::span<ContactBody> bodies, const ContactSettings& settings, size_t grain = 16, JobSystem& jobs = JobSystem::Default()) const {
+			jobs.ParallelFor(Count(), grain, [&](size_t begin, size_t end) {
+				for(size_t island = begin; island < end; island++)
+					SolveContacts(contacts.subspan(start[island], start[island + 1] - start[island]), bodies, settings);
+			});
+		}
+
+	private:
+		uint32_t Find(uint32_t body) {
+			while(parent[body] != body)
+				body = parent[body] = parent[parent[body]];					// path halving
+			return body;
+		}
+	};
+}
+
+#endif // COLLISION_HPP
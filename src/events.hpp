@@ -0,0 +1,113 @@
+#ifndef EVENTS_HPP
+#define EVENTS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace cs381 {
+
+	// queue of one event type with many producers and a single consumer
+	// every producing thread appends to its own buffer, so pushing takes no locks and no atomics once the thread's buffer exists
+	// buffers are found through a lock-free list, threads pushing for the first time add theirs with a compare and swap
+	template<typename Tevent>
+	struct EventChannel {
+		struct Buffer {
+			std::thread::id thread;
+			std::vector<Tevent> events;
+			Buffer* next = nullptr;
+
+			explicit Buffer(std::thread::id thread) : thread(thread) {}
+		};
+
+		std::atomic<Buffer*> buffers = nullptr;
+		uint64_t id = nextID.fetch_add(1, std::memory_order_relaxed);	// identifies the channel in thread local caches, addresses get reused
+
+		EventChannel() = default;
+		EventChannel(const EventChannel&) = delete;
+		~EventChannel() {
+			for(Buffer* buffer = buffers.load(); buffer; )
+				delete std::exchange(buffer, buffer->next);
+		}
+
+		void Push(Tevent event) { Local().events.push_back(std::move(event)); }
+
+		// calls fn(event) for every queued event (each thread's events in the order they were pushed) and empties the queue
+		// nothing may push while draining, e.g. call it after Scheduler::Run returns
+		template<typename F>
+		void Drain(F&& fn) {
+			for(Buffer* buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+				for(auto& event: buffer->events)
+					fn(event);
+				buffer->events.clear();										// keeps the capacity for the next frame
+			}
+		}
+
+		bool Empty() const {
+			for(Buffer* buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+				if(!buffer->events.empty()) return false;
+			return true;
+		}
+
+	private:
+		inline static std::atomic<uint64_t> nextID = 1;
+		struct Cache {
+			uint64_t channel = 0;
+			Buffer* buffer = nullptr;
+		};
+		inline static thread_local Cache cache;							// the buffer the current thread last pushed to
+
+		Buffer& Local() {
+			if(cache.channel == id) return *cache.buffer;
+			std::thread::id self = std::this_thread::get_id();
+			Buffer* head = buffers.load(std::memory_order_acquire);
+			Buffer* local = nullptr;
+			for(Buffer* buffer = head; buffer && !local; buffer = buffer->next)
+				if(buffer->thread == self) local = buffer;
+			if(!local) {
+				local = new Buffer(self);
+				local->next = head;
+				while(!buffers.compare_exchange_weak(local->next, local, std::memory_order_release, std::memory_order_acquire));
+			}
+			cache = {id, local};
+			return *local;
+		}
+	};
+
+	// typed event bus: systems push events from any thread while they run, a later stage dispatches them all to listeners in one batch
+	// so systems don't need to reach into game state (or each other) to report what happened
+	template<typename... Tevents>
+	struct EventBus {
+		std::tuple<EventChannel<Tevents>...> channels;
+		std::tuple<std::vector<std::function<void(const Tevents&)>>...> listeners;
+
+		template<typename Tevent>
+		void Push(Tevent event) { std::get<EventChannel<Tevent>>(channels).Push(std::move(event)); }
+
+		// listeners are called on the thread calling Dispatch, in the order they were added
+		template<typename Tevent>
+		void Listen(std::function<void(const Tevent&)> listener) { std::get<std::vector<std::function<void(const Tevent&)>>>(listeners).push_back(std::move(listener)); }
+
+		// delivers every queued event, one event type at a time in the order of Tevents, nothing (listeners included) may push meanwhile
+		void Dispatch() {
+			(DispatchAll<Tevents>(), ...);
+		}
+
+	private:
+		template<typename Tevent>
+		void DispatchAll() {
+			auto& channel = std::get<EventChannel<Tevent>>(channels);
+			auto& listening = std::get<std::vector<std::function<void(const Tevent&)>>>(listeners);
+			channel.Drain([&](const Tevent& event) {
+				for(auto& listener: listening)
+					listener(event);
+			});
+		}
+	};
+}
+
+#endif // EVENTS_HPP
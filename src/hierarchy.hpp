@@ -0,0 +1,205 @@
+#ifndef HIERARCHY_HPP
+#define HIERARCHY_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "raylib-cpp.hpp"
+#include "ECS.hpp"
+
+// transforms and the scene graph placing entities relative to their parents
+// TransformHierarchy's members are templates over the scene's storage, so the ComponentRegistry only has to be declared (with these components) before they are used
+
+// the same matrix as Identity().Scale(scale) * CreateRotateY(heading) * CreateTranslate(position), built directly from one sincos
+inline raylib::Matrix TransformMatrix(raylib::Vector3 position, float heading, float scale = 1.0f)
+{
+    float sine = std::sin(heading * DEG2RAD);     // the compiler merges these two into a single sincos call
+    float cosine = std::cos(heading * DEG2RAD);
+    return raylib::Matrix(
+        scale * cosine,  0.0f,  scale * sine,   position.x,
+        0.0f,            scale, 0.0f,           position.y,
+        -scale * sine,   0.0f,  scale * cosine, position.z,
+        0.0f,            0.0f,  0.0f,           1.0f);
+}
+
+struct TransformComponent
+{
+    raylib::Vector3 position = {0, 0, 0};
+    float heading = 0.0f;
+};
+
+// the transform as of the previous simulation tick, rendering interpolates from it to the current one
+struct PreviousTransformComponent
+{
+    raylib::Vector3 position = {0, 0, 0};
+    float heading = 0.0f;
+};
+
+// scene graph: an entity with a ParentComponent has its TransformComponent relative to its parent
+// the children of an entity form a list threaded through their ParentComponents, so both stay trivially copyable for snapshots
+struct ParentComponent
+{
+    cs381::Entity parent = cs381::InvalidEntity;
+    cs381::Entity nextSibling = cs381::InvalidEntity;
+};
+
+struct ChildrenComponent
+{
+    cs381::Entity first = cs381::InvalidEntity;
+    uint32_t count = 0;
+};
+
+// transform relative to the world, written by TransformHierarchy::Propagate (a plain ::Matrix, raylib::Matrix isn't trivially copyable)
+struct WorldTransformComponent
+{
+    ::Matrix matrix = raylib::Matrix::Identity();
+};
+
+// every entity with a TransformComponent and a WorldTransformComponent, in breadth-first order from the roots
+// parents always come before their children, so one linear pass over order updates every world matrix
+struct TransformHierarchy
+{
+    static constexpr uint32_t Root = std::numeric_limits<uint32_t>::max();
+
+    struct Node
+    {
+        cs381::Entity entity;
+        uint32_t parent;                // position of the parent in order, Root for roots
+    };
+
+    std::vector<Node> order;
+    std::vector<bool> dirty;            // per position, whether the world matrix was recomputed during the current pass
+    size_t members = 0;                 // entities with both components at the last rebuild
+    bool rebuild = true;                // set whenever parents change, Propagate also rebuilds when Stale finds entities came or went
+    uint32_t lastRun = 0;
+
+    // makes child's transform relative to parent, InvalidEntity makes child a root again
+    template<typename Storage>
+    void SetParent(cs381::Scene<Storage>& scene, cs381::Entity child, cs381::Entity parent)
+    {
+        Detach(scene, child);
+        if (parent != cs381::InvalidEntity)
+        {
+            if (!scene.template HasComponent<ChildrenComponent>(parent))
+            {
+                scene.template AddComponent<ChildrenComponent>(parent);
+            }
+            auto& children = scene.template GetComponent<ChildrenComponent>(parent);
+            scene.template AddComponent<ParentComponent>(child) = {parent, children.first};
+            children.first = child;
+            children.count++;
+        }
+        rebuild = true;
+    }
+
+    template<typename Storage>
+    void Rebuild(cs381::Scene<Storage>& scene)
+    {
+        order.clear();
+        auto query = scene.template GetQuery<TransformComponent, WorldTransformComponent>();
+        members = query.size();
+        query.ForEach([&](cs381::Entity e, TransformComponent&, WorldTransformComponent&)
+        {
+            if (!scene.template HasComponent<ParentComponent>(e) || !scene.IsAlive(scene.template GetComponent<ParentComponent>(e).parent))
+            {
+                order.push_back({e, Root});
+            }
+        });
+
+        for (uint32_t i = 0; i < order.size(); i++)    // order doubles as the breadth-first queue
+        {
+            if (!scene.template HasComponent<ChildrenComponent>(order[i].entity)) continue;
+            for (cs381::Entity child = scene.template GetComponent<ChildrenComponent>(order[i].entity).first; scene.IsAlive(child); child = scene.template GetComponent<ParentComponent>(child).nextSibling)
+            {
+                if (scene.template HasComponent<TransformComponent>(child) && scene.template HasComponent<WorldTransformComponent>(child))
+                {
+                    order.push_back({child, i});
+                }
+            }
+        }
+        rebuild = false;
+    }
+
+    // whether order is out of date: entities gained both components since the last rebuild, or one of its nodes was destroyed or lost either
+    // one pass of signature tests, cheap next to recomputing the matrices
+    template<typename Storage>
+    bool Stale(cs381::Scene<Storage>& scene) const
+    {
+        if (scene.template GetQuery<TransformComponent, WorldTransformComponent>().size() != members) return true;
+        for (auto [e, parent] : order)
+        {
+            if (!scene.IsAlive(e) || !scene.template HasComponent<TransformComponent>(e) || !scene.template HasComponent<WorldTransformComponent>(e)) return true;
+        }
+        return false;
+    }
+
+    // recomputes the world matrix of every entity whose transform, or any of whose ancestors' transforms, changed since the last call
+    // entities with a PreviousTransformComponent are placed alpha of the way from their previous transform to the current one
+    template<typename Storage>
+    void Propagate(cs381::Scene<Storage>& scene, float alpha = 1.0f)
+    {
+        bool everything = rebuild || Stale(scene);
+        if (everything) Rebuild(scene);
+        uint32_t since = std::exchange(lastRun, scene.changes.Advance());
+        dirty.assign(order.size(), false);
+
+        for (uint32_t i = 0; i < order.size(); i++)
+        {
+            auto [e, parent] = order[i];
+            auto& transform = scene.template GetComponent<TransformComponent>(e);
+            size_t index = cs381::EntityIndex(e);
+            bool changed = everything || scene.changes.template Passes<cs381::Changed<TransformComponent>>(index, since) || (parent != Root && dirty[parent]);
+
+            const PreviousTransformComponent* previous = nullptr;
+            if (scene.template HasComponent<PreviousTransformComponent>(e))
+            {
+                previous = &scene.template GetComponent<PreviousTransformComponent>(e);
+                bool moving = previous->position != transform.position || previous->heading != transform.heading;  // alpha moves on every frame
+                changed = changed || moving || scene.changes.template Passes<cs381::Changed<PreviousTransformComponent>>(index, since);
+            }
+            if (!changed) continue;     // the whole subtree is skipped unless a descendant changed on its own
+            dirty[i] = true;
+
+            raylib::Matrix local = previous
+                ? TransformMatrix(raylib::Vector3(previous->position).Lerp(transform.position, alpha), std::lerp(previous->heading, transform.heading, alpha))
+                : TransformMatrix(transform.position, transform.heading);
+            auto& world = scene.template GetComponent<WorldTransformComponent>(e);
+            world.matrix = parent == Root ? local : local * scene.template GetComponent<WorldTransformComponent>(order[parent].entity).matrix;
+            scene.template MarkChanged<WorldTransformComponent>(e);
+        }
+    }
+
+private:
+    template<typename Storage>
+    void Detach(cs381::Scene<Storage>& scene, cs381::Entity child)
+    {
+        if (!scene.template HasComponent<ParentComponent>(child)) return;
+        auto [parent, next] = scene.template GetComponent<ParentComponent>(child);
+        if (scene.IsAlive(parent) && scene.template HasComponent<ChildrenComponent>(parent))
+        {
+            auto& children = scene.template GetComponent<ChildrenComponent>(parent);
+            if (children.first == child)
+            {
+                children.first = next;
+            }
+            else
+            {
+                cs381::Entity previous = children.first;
+                while (scene.IsAlive(previous) && scene.template GetComponent<ParentComponent>(previous).nextSibling != child)
+                {
+                    previous = scene.template GetComponent<ParentComponent>(previous).nextSibling;
+                }
+                if (scene.IsAlive(previous))
+                {
+                    scene.template GetComponent<ParentComponent>(previous).nextSibling = next;
+                }
+            }
+            children.count--;
+        }
+        scene.template RemoveComponent<ParentComponent>(child);
+    }
+};
+
+#endif // HIERARCHY_HPP
@@ -0,0 +1,181 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cs381 {
+
+	// counts the unfinished jobs of a group, continuations added with JobSystem::Then run once it drops to zero
+	struct JobGroup {
+		std::atomic<size_t> pending = 0;
+		std::mutex mutex;										// guards continuations, and is held while the last job of the group finishes
+		std::vector<std::function<void()>> continuations;
+
+		bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+	};
+
+	// work stealing job system: every worker owns a deque, it pushes and pops its own jobs at the back
+	// while idle workers steal the oldest (and usually largest) jobs from the front of someone else's deque
+	struct JobSystem {
+		struct Job {
+			std::function<void()> work;
+			JobGroup* group = nullptr;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;			// queue 0 is shared by every thread that isn't a worker (e.g. the main thread)
+		std::vector<std::thread> workers;					// worker i owns queues[i + 1]
+		std::atomic<size_t> queued = 0;						// jobs sitting in any queue
+		std::atomic<size_t> sleeping = 0;					// workers waiting for jobs
+		std::atomic<bool> stopping = false;
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+
+		inline static thread_local JobSystem* owner = nullptr;	// job system the current thread works for
+		inline static thread_local size_t ownQueue = 0;
+
+		JobSystem(size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1) {	// the calling thread helps while it waits, so leave it a core
+			for(size_t i = 0; i <= threads; i++)
+				queues.push_back(std::make_unique<Queue>());
+			for(size_t i = 0; i < threads; i++)
+				workers.emplace_back([this, i] { Work(i + 1); });
+		}
+		JobSystem(const JobSystem&) = delete;
+		~JobSystem() {
+			{
+				std::scoped_lock lock(sleepMutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for(auto& worker: workers)
+				worker.join();
+		}
+
+		static JobSystem& Default() {							// process wide job system used by Scene::ParallelForEach and the Scheduler
+			static JobSystem jobs;
+			return jobs;
+		}
+
+		size_t ThreadCount() const { return workers.size() + 1; }
+
+		void Submit(std::function<void()> work, JobGroup* group = nullptr) {
+			if(group) group->pending.fetch_add(1, std::memory_order_relaxed);
+			auto& queue = *queues[owner == this ? ownQueue : 0];
+			{
+				std::scoped_lock lock(queue.mutex);
+				queue.jobs.push_back({std::move(work), group});
+			}
+			queued.fetch_add(1);
+			if(sleeping.load() > 0) {
+				std::scoped_lock lock(sleepMutex);			// a worker between checking for work and sleeping holds this lock, so it can't miss the notify
+				wake.notify_one();
+			}
+		}
+
+		// submits work once every job of group has finished (immediately if it already has)
+		void Then(JobGroup& group, std::function<void()> work) {
+			{
+				std::scoped_lock lock(group.mutex);
+				if(!group.Done()) {
+					group.continuations.push_back(std::move(work));
+					return;
+				}
+			}
+			Submit(std::move(work));
+		}
+
+		// runs one queued job on the calling thread, false if there was nothing to run
+		bool RunOne() {
+			Job job;
+			if(!Take(job)) return false;
+			job.work();
+			if(job.group) Finish(*job.group);
+			return true;
+		}
+
+		// blocks until every job of group has finished, running other jobs in the meantime
+		void Wait(JobGroup& group) {
+			while(!group.Done())
+				if(!RunOne()) std::this_thread::yield();
+			std::scoped_lock lock(group.mutex);				// the thread that finished the last job may still be holding it
+		}
+
+		// calls fn(begin, end) over [0, count) in ranges of at most grain elements, returns once every range is done
+		// the range is split in halves: the calling thread keeps the left half and pushes the right one, which a thief splits further
+		template<typename F>
+		void ParallelFor(size_t count, size_t grain, F&& fn) {
+			if(count == 0) return;
+			JobGroup group;
+			Split(0, count, std::max<size_t>(grain, 1), fn, group);
+			Wait(group);
+		}
+
+	private:
+		template<typename F>
+		void Split(size_t begin, size_t end, size_t grain, F& fn, JobGroup& group) {
+			while(end - begin > grain) {
+				size_t middle = begin + (end - begin) / 2;
+				Submit([this, middle, end, grain, &fn, &group] { Split(middle, end, grain, fn, group); }, &group);
+				end = middle;
+			}
+			fn(begin, end);
+		}
+
+		bool Take(Job& job) {
+			if(queued.load() == 0) return false;
+			size_t own = owner == this ? ownQueue : 0;
+			for(size_t i = 0; i < queues.size(); i++) {
+				auto& queue = *queues[(own + i) % queues.size()];
+				std::scoped_lock lock(queue.mutex);
+				if(queue.jobs.empty()) continue;
+				if(i == 0) {										// our own queue: newest job first, it's the one still in cache
+					job = std::move(queue.jobs.back());
+					queue.jobs.pop_back();
+				} else {											// someone else's: steal the oldest
+					job = std::move(queue.jobs.front());
+					queue.jobs.pop_front();
+				}
+				queued.fetch_sub(1);
+				return true;
+			}
+			return false;
+		}
+
+		void Finish(JobGroup& group) {
+			std::vector<std::function<void()>> ready;
+			{
+				std::scoped_lock lock(group.mutex);
+				if(group.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					std::swap(ready, group.continuations);
+			}
+			for(auto& work: ready)
+				Submit(std::move(work));
+		}
+
+		void Work(size_t queue) {
+			owner = this;
+			ownQueue = queue;
+			while(!stopping) {
+				if(RunOne()) continue;
+				std::unique_lock lock(sleepMutex);
+				sleeping.fetch_add(1);
+				wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+				sleeping.fetch_sub(1);
+			}
+		}
+	};
+}
+
+#endif // JOBS_HPP
@@ -0,0 +1,186 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "ECS.hpp"
+#include "jobs.hpp"
+
+namespace cs381 {
+
+	// base of the per-entity kernels a Pipeline runs: operator()(entity, Tcomponents&...) is called for every entity having all of Tcomponents
+	// const components are only read; a kernel that also reads other entities' components (e.g. through a Scene pointer) lists them in CrossReads
+	template<typename... Tcomponents>
+	struct Kernel {
+		using Components = std::tuple<Tcomponents...>;
+		using CrossReads = std::tuple<>;
+	};
+
+	// a kernel may instead take a whole block of entities at once with Batch(scene, indices), indices being the ascending slots (at most 64) of the block's entities
+	// that have its components; the pipeline then calls it rather than operator(), so it can gather fields into lanes and run SIMD code across entities
+	// a pass holding a batch kernel runs each of its kernels over a block before the next one starts, rather than all of them entity by entity
+	template<typename Tkernel, typename Storage>
+	concept BatchKernel = requires(Tkernel& kernel, Scene<Storage>& scene, std::span<const size_t> indices) { kernel.Batch(scene, indices); };
+
+	enum class Fusion {
+		Generic,				// every kernel runs in the same loop, in order, for each entity
+		Checked,				// the loop is split wherever a kernel reads other entities' components that an earlier kernel of the loop writes (or the other way around)
+	};
+
+	template<typename Tkernel>
+	struct KernelTraits {
+		template<typename... Ts>
+		static constexpr Signature Required(std::tuple<Ts...>*) { return MakeSignature<std::remove_const_t<Ts>...>(); }
+		template<typename... Ts>
+		static constexpr Signature Written(std::tuple<Ts...>*) {
+			Signature out;
+			(out.set(GetComponentID<std::remove_const_t<Ts>>(), !std::is_const_v<Ts>), ...);
+			return out;
+		}
+		template<typename... Ts>
+		static constexpr Signature Read(std::tuple<Ts...>*) {
+			Signature out;
+			(out.set(GetComponentID<std::remove_const_t<Ts>>()), ...);
+			return out;
+		}
+
+		static constexpr Signature required = Required((typename Tkernel::Components*)nullptr);
+		static constexpr Signature writes = Written((typename Tkernel::Components*)nullptr);
+		static constexpr Signature crossReads = Read((typename Tkernel::CrossReads*)nullptr);
+	};
+
+	// runs several per-entity kernels in as few passes over the scene as possible, so each entity's components are loaded once for all of them
+	// e.g. Pipeline(MoveKernel{dt}, SteerKernel{dt}).Run(scene) updates every entity with MoveKernel then SteerKernel before moving on to the next
+	template<typename... Tkernels>
+	struct Pipeline {
+		static constexpr size_t KernelCount = sizeof...(Tkernels);
+		static constexpr std::array<Signature, KernelCount> required = {KernelTraits<Tkernels>::required...};
+		static constexpr std::array<Signature, KernelCount> writes = {KernelTraits<Tkernels>::writes...};
+		static constexpr std::array<Signature, KernelCount> crossReads = {KernelTraits<Tkernels>::crossReads...};
+
+		std::tuple<Tkernels...> kernels;
+
+		Pipeline(Tkernels... kernels) : kernels(std::move(kernels)...) {}
+
+		// kernel k starts a new pass if breaks[k] is set
+		template<Fusion mode>
+		static constexpr std::array<bool, KernelCount> Breaks() {
+			std::array<bool, KernelCount> breaks{};
+			if constexpr (mode == Fusion::Checked)
+				for(size_t k = 0, start = 0; k < KernelCount; k++)
+					for(size_t i = start; i < k; i++)
+						if(crossReads[k].Intersects(writes[i]) || crossReads[i].Intersects(writes[k])) {
+							breaks[k] = true;
+							start = k;
+							break;
+						}
+			return breaks;
+		}
+
+		template<Fusion mode = Fusion::Checked, typename Storage>
+		void Run(Scene<Storage>& scene) {
+			ForEachPass<mode>([&](size_t first, size_t last) {
+				RunRange(scene, first, last, 0, scene.entityMasks.size());
+			});
+		}
+
+		// like Run, but every pass is spread over the job system in ranges of (about) grain entity slots
+		// kernels run concurrently, so they may only touch the entity they are given, plus components nothing in the pipeline writes
+		template<Fusion mode = Fusion::Checked, typename Storage>
+		void ParallelRun(Scene<Storage>& scene, size_t grain = 1024, JobSystem& jobs = JobSystem::Default()) {
+			if constexpr (mode == Fusion::Checked) {
+				constexpr bool racy = [] {
+					Signature written;
+					for(auto w: writes) written.bits |= w.bits;
+					for(auto r: crossReads)
+						if(r.Intersects(written)) return true;
+					return false;
+				}();
+				static_assert(!racy, "a kernel reads other entities' components that the pipeline writes, run it with Run instead");
+			}
+			size_t blocks = (scene.entityMasks.size() + 63) / 64;			// ranges start on 64 slot boundaries so MatchSignatures sees whole blocks
+			ForEachPass<mode>([&](size_t first, size_t last) {
+				jobs.ParallelFor(blocks, std::max<size_t>(grain / 64, 1), [&](size_t begin, size_t end) {
+					RunRange(scene, first, last, begin * 64, std::min(end * 64, scene.entityMasks.size()));
+				});
+			});
+		}
+
+	private:
+		template<Fusion mode, typename F>
+		static void ForEachPass(F&& pass) {								// calls pass(first, last) for every run of kernels [first, last) fused into one loop
+			constexpr auto breaks = Breaks<mode>();
+			for(size_t first = 0, last = 1; first < KernelCount; first = last++) {
+				while(last < KernelCount && !breaks[last]) last++;
+				pass(first, last);
+			}
+		}
+
+		template<typename Storage>
+		void RunRange(Scene<Storage>& scene, size_t first, size_t last, size_t begin, size_t end) {
+			Signature common{~uint64_t(0)};							// components every kernel of the pass needs, entities without them are skipped 64 at a time
+			for(size_t k = first; k < last; k++)
+				common.bits &= required[k].bits;
+
+			constexpr std::array<bool, KernelCount> batched = {BatchKernel<Tkernels, Storage>...};
+			bool anyBatched = false;
+			for(size_t k = first; k < last; k++)
+				anyBatched |= batched[k];
+
+			for(size_t block = begin; block < end; block += 64) {
+				size_t count = std::min<size_t>(64, end - block);
+				uint64_t matches = MatchSignatures(scene.entityMasks.data() + block, count, common);
+				if(anyBatched) {
+					// kernels take turns over the block instead, each entity still sees them in order and the block's components stay in cache between them
+					if(matches) RunBlock(scene, block, count, first, last, std::index_sequence_for<Tkernels...>{});
+				} else
+					for(; matches; matches &= matches - 1) {
+						size_t index = block + std::countr_zero(matches);
+						RunKernels(scene, index, first, last, std::index_sequence_for<Tkernels...>{});
+					}
+			}
+		}
+
+		template<typename Storage, size_t... Ks>
+		void RunKernels(Scene<Storage>& scene, size_t index, size_t first, size_t last, std::index_sequence<Ks...>) {
+			Entity e = scene.GetEntity(index);
+			Signature mask = scene.entityMasks[index];
+			((Ks >= first && Ks < last && mask.Contains(required[Ks]) ? Call(std::get<Ks>(kernels), scene, index, e, (typename std::tuple_element_t<Ks, std::tuple<Tkernels...>>::Components*)nullptr) : void()), ...);
+		}
+
+		template<typename Storage, size_t... Ks>
+		void RunBlock(Scene<Storage>& scene, size_t block, size_t count, size_t first, size_t last, std::index_sequence<Ks...>) {
+			((Ks >= first && Ks < last ? RunKernelOnBlock<Ks>(scene, block, count) : void()), ...);
+		}
+
+		template<size_t K, typename Storage>
+		void RunKernelOnBlock(Scene<Storage>& scene, size_t block, size_t count) {
+			using Tkernel = std::tuple_element_t<K, std::tuple<Tkernels...>>;
+			auto& kernel = std::get<K>(kernels);
+			uint64_t matches = MatchSignatures(scene.entityMasks.data() + block, count, required[K]);
+			if constexpr (BatchKernel<Tkernel, Storage>) {
+				std::array<size_t, 64> indices;
+				size_t matched = 0;
+				for(; matches; matches &= matches - 1)
+					indices[matched++] = block + std::countr_zero(matches);
+				if(matched) kernel.Batch(scene, std::span<const size_t>(indices.data(), matched));
+			} else
+				for(; matches; matches &= matches - 1) {
+					size_t index = block + std::countr_zero(matches);
+					Call(kernel, scene, index, scene.GetEntity(index), (typename Tkernel::Components*)nullptr);
+				}
+		}
+
+		template<typename Tkernel, typename Storage, typename... Ts>
+		static void Call(Tkernel& kernel, Scene<Storage>& scene, size_t index, Entity e, std::tuple<Ts...>*) {
+			if constexpr (!BatchKernel<Tkernel, Storage>)					// batch kernels never run entity by entity, see RunRange
+				kernel(e, scene.template GetComponentAt<Ts>(index)...);	// const components are only read
+		}
+	};
+}
+
+#endif // PIPELINE_HPP
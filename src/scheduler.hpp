@@ -0,0 +1,115 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ECS.hpp"
+#include "jobs.hpp"
+
+namespace cs381 {
+
+	// access declarations, any type can appear in them: components, or resources such as a game state struct
+	template<typename... Ttypes> struct Reads {};
+	template<typename... Ttypes> struct Writes {};
+
+	// runs systems as jobs, systems whose declared accesses don't conflict run at the same time
+	// two systems conflict if either one writes a type the other reads or writes, conflicting systems run in the order they were added
+	// systems running in parallel may read and write components, but must not create/destroy entities or add/remove components
+	struct Scheduler {
+		struct System {
+			std::string name;
+			std::vector<uint64_t> reads;			// sorted hashes of the types the system reads
+			std::vector<uint64_t> writes;			// sorted hashes of the types the system writes
+			bool mainThread = false;				// must run on the thread calling Run (e.g. anything that draws)
+			std::function<void()> run;
+		};
+
+		std::vector<System> systems;
+		JobSystem& jobs;
+
+		Scheduler(JobSystem& jobs = JobSystem::Default()) : jobs(jobs) {}
+
+		template<typename... Treads, typename... Twrites>
+		System& Add(std::string name, Reads<Treads...>, Writes<Twrites...>, std::function<void()> run, bool mainThread = false) {
+			System system{std::move(name), {ComponentHash<Treads>()...}, {ComponentHash<Twrites>()...}, mainThread, std::move(run)};
+			std::sort(system.reads.begin(), system.reads.end());
+			std::sort(system.writes.begin(), system.writes.end());
+			return systems.emplace_back(std::move(system));
+		}
+
+		static bool Conflicts(const System& a, const System& b) {
+			auto intersects = [](const std::vector<uint64_t>& x, const std::vector<uint64_t>& y) {
+				for(auto i = x.begin(), j = y.begin(); i != x.end() && j != y.end(); )
+					if(*i == *j) return true;
+					else if(*i < *j) i++;
+					else j++;
+				return false;
+			};
+			return intersects(a.writes, b.writes) || intersects(a.writes, b.reads) || intersects(a.reads, b.writes);
+		}
+
+		// runs every system once, returns when all of them have finished
+		void Run() {
+			size_t count = systems.size();
+			std::vector<std::vector<size_t>> dependents(count);				// edges of the dependency DAG
+			std::vector<size_t> remaining(count, 0);						// unfinished dependencies of each system
+			for(size_t j = 0; j < count; j++)
+				for(size_t i = 0; i < j; i++)
+					if(Conflicts(systems[i], systems[j])) {
+						dependents[i].push_back(j);
+						remaining[j]++;
+					}
+
+			std::mutex mutex;
+			std::condition_variable changed;
+			std::vector<size_t> mainThreadReady;
+			size_t finished = 0;
+
+			std::function<void(size_t)> launch;								// called with mutex held
+			auto finish = [&](size_t i) {
+				std::scoped_lock lock(mutex);
+				for(size_t dependent: dependents[i])
+					if(--remaining[dependent] == 0)
+						launch(dependent);
+				finished++;
+				changed.notify_all();
+			};
+			launch = [&](size_t i) {
+				if(systems[i].mainThread)
+					mainThreadReady.push_back(i);
+				else jobs.Submit([&, i] { systems[i].run(); finish(i); });
+			};
+
+			{
+				std::scoped_lock lock(mutex);
+				for(size_t i = 0; i < count; i++)
+					if(remaining[i] == 0) launch(i);
+			}
+
+			while(true) {													// the calling thread runs main thread systems as they become ready, and helps with jobs otherwise
+				std::unique_lock lock(mutex);
+				if(finished == count) break;
+				if(!mainThreadReady.empty()) {
+					size_t i = mainThreadReady.back();
+					mainThreadReady.pop_back();
+					lock.unlock();
+					systems[i].run();
+					finish(i);
+					continue;
+				}
+				lock.unlock();
+				if(!jobs.RunOne()) {
+					lock.lock();
+					changed.wait_for(lock, std::chrono::microseconds(100), [&] { return finished == count || !mainThreadReady.empty(); });
+				}
+			}
+		}
+	};
+}
+
+#endif // SCHEDULER_HPP
@@ -0,0 +1,156 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+	#include <immintrin.h>
+	#define CS381_SIMD_X86 1
+#endif
+
+// every variant below must round after each operation: a fused multiply-add rounds once, so contracting some of them (as builds targeting FMA
+// hardware do by default) would make the variants disagree in the last bit
+#if defined(__clang__)
+	#define CS381_NO_FP_CONTRACT _Pragma("clang fp contract(off)")
+#elif defined(__GNUC__)
+	#pragma GCC push_options
+	#pragma GCC optimize("fp-contract=off")
+	#define CS381_NO_FP_CONTRACT
+#else
+	#define CS381_NO_FP_CONTRACT
+#endif
+
+namespace cs381 {
+
+	namespace detail {
+		// x is reduced to r in [-pi/4, pi/4] and a quadrant q = round(x * 2/pi), pi/2 is split in three (Cody-Waite) so that q * part is exact for the first two
+		// sin and cos of r are the minimax polynomials from Cephes' sinf/cosf
+		constexpr float TwoOverPi = 0.636619772367581343f;
+		constexpr float PiOver2A = 1.5703125f;
+		constexpr float PiOver2B = 4.837512969970703125e-4f;
+		constexpr float PiOver2C = 7.54978995489188216e-8f;
+		constexpr float SinP0 = -1.6666654611e-1f, SinP1 = 8.3321608736e-3f, SinP2 = -1.9515295891e-4f;
+		constexpr float CosP0 = 4.166664568298827e-2f, CosP1 = -1.388731625493765e-3f, CosP2 = 2.443315711809948e-5f;
+		constexpr float SinCosLimit = 8192.0f;								// the reduction loses accuracy past this, such angles (and NaNs) go to std::sin/std::cos
+
+		// every variant evaluates the same operations in the same order with FP contraction off, so they give bit identical results
+		// (which keeps replays deterministic whichever variant a machine picks) whatever the build targets
+		inline void SinCosOne(float x, float& sine, float& cosine) {
+			CS381_NO_FP_CONTRACT
+			if(!(std::fabs(x) <= SinCosLimit)) {
+				sine = std::sin(x);
+				cosine = std::cos(x);
+				return;
+			}
+			float q = std::nearbyint(x * TwoOverPi);
+			float r = ((x - q * PiOver2A) - q * PiOver2B) - q * PiOver2C;
+			float r2 = r * r;
+			float s = r + (r * r2) * (SinP0 + r2 * (SinP1 + r2 * SinP2));
+			float c = (1.0f - 0.5f * r2) + (r2 * r2) * (CosP0 + r2 * (CosP1 + r2 * CosP2));
+			int quadrant = int(q);
+			if(quadrant & 1) std::swap(s, c);
+			sine = quadrant & 2 ? -s : s;
+			cosine = (quadrant + 1) & 2 ? -c : c;
+		}
+
+		inline void SinCosScalar(const float* radians, float* sines, float* cosines, size_t count) {
+			CS381_NO_FP_CONTRACT
+			for(size_t i = 0; i < count; i++)
+				SinCosOne(radians[i], sines[i], cosines[i]);
+		}
+
+#ifdef CS381_SIMD_X86
+		__attribute__((target("sse2"))) inline void SinCosSSE2(const float* radians, float* sines, float* cosines, size_t count) {
+			CS381_NO_FP_CONTRACT
+			const __m128 signBit = _mm_set1_ps(-0.0f);
+			const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+			size_t i = 0;
+			for(; i + 4 <= count; i += 4) {
+				__m128 x = _mm_loadu_ps(radians + i);
+				__m128i qi = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TwoOverPi)));	// rounds to nearest even, like nearbyint
+				__m128 q = _mm_cvtepi32_ps(qi);
+				__m128 r = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PiOver2A))), _mm_mul_ps(q, _mm_set1_ps(PiOver2B))), _mm_mul_ps(q, _mm_set1_ps(PiOver2C)));
+				__m128 r2 = _mm_mul_ps(r, r);
+				__m128 sp = _mm_add_ps(_mm_set1_ps(SinP0), _mm_mul_ps(r2, _mm_add_ps(_mm_set1_ps(SinP1), _mm_mul_ps(r2, _mm_set1_ps(SinP2)))));
+				__m128 s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sp));
+				__m128 cp = _mm_add_ps(_mm_set1_ps(CosP0), _mm_mul_ps(r2, _mm_add_ps(_mm_set1_ps(CosP1), _mm_mul_ps(r2, _mm_set1_ps(CosP2)))));
+				__m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), cp));
+
+				__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(qi, one), one));	// odd quadrants exchange sin and cos
+				__m128 sine = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+				__m128 cosine = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+				sine = _mm_xor_ps(sine, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(qi, two), 30)));
+				cosine = _mm_xor_ps(cosine, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(qi, one), two), 30)));
+				_mm_storeu_ps(sines + i, sine);
+				_mm_storeu_ps(cosines + i, cosine);
+
+				int outside = _mm_movemask_ps(_mm_cmpnle_ps(_mm_andnot_ps(signBit, x), _mm_set1_ps(SinCosLimit)));	// NaNs compare "not less or equal" too
+				for(; outside; outside &= outside - 1) {
+					size_t lane = i + __builtin_ctz(outside);
+					SinCosOne(radians[lane], sines[lane], cosines[lane]);
+				}
+			}
+			SinCosScalar(radians + i, sines + i, cosines + i, count - i);
+		}
+
+		__attribute__((target("avx2"))) inline void SinCosAVX2(const float* radians, float* sines, float* cosines, size_t count) {
+			CS381_NO_FP_CONTRACT
+			const __m256 signBit = _mm256_set1_ps(-0.0f);
+			const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+			size_t i = 0;
+			for(; i + 8 <= count; i += 8) {
+				__m256 x = _mm256_loadu_ps(radians + i);
+				__m256i qi = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TwoOverPi)));
+				__m256 q = _mm256_cvtepi32_ps(qi);
+				__m256 r = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(PiOver2A))), _mm256_mul_ps(q, _mm256_set1_ps(PiOver2B))), _mm256_mul_ps(q, _mm256_set1_ps(PiOver2C)));
+				__m256 r2 = _mm256_mul_ps(r, r);
+				__m256 sp = _mm256_add_ps(_mm256_set1_ps(SinP0), _mm256_mul_ps(r2, _mm256_add_ps(_mm256_set1_ps(SinP1), _mm256_mul_ps(r2, _mm256_set1_ps(SinP2)))));
+				__m256 s = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), sp));
+				__m256 cp = _mm256_add_ps(_mm256_set1_ps(CosP0), _mm256_mul_ps(r2, _mm256_add_ps(_mm256_set1_ps(CosP1), _mm256_mul_ps(r2, _mm256_set1_ps(CosP2)))));
+				__m256 c = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_mul_ps(_mm256_mul_ps(r2, r2), cp));
+
+				__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(qi, one), one));
+				__m256 sine = _mm256_blendv_ps(s, c, swap);
+				__m256 cosine = _mm256_blendv_ps(c, s, swap);
+				sine = _mm256_xor_ps(sine, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(qi, two), 30)));
+				cosine = _mm256_xor_ps(cosine, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(qi, one), two), 30)));
+				_mm256_storeu_ps(sines + i, sine);
+				_mm256_storeu_ps(cosines + i, cosine);
+
+				int outside = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_andnot_ps(signBit, x), _mm256_set1_ps(SinCosLimit), _CMP_NLE_UQ));
+				for(; outside; outside &= outside - 1) {
+					size_t lane = i + __builtin_ctz(outside);
+					SinCosOne(radians[lane], sines[lane], cosines[lane]);
+				}
+			}
+			SinCosSSE2(radians + i, sines + i, cosines + i, count - i);
+		}
+#endif
+
+		using SinCosFunction = void (*)(const float*, float*, float*, size_t);
+
+		inline SinCosFunction SelectSinCos() {
+#ifdef CS381_SIMD_X86
+			if(__builtin_cpu_supports("avx2")) return SinCosAVX2;
+			if(__builtin_cpu_supports("sse2")) return SinCosSSE2;
+#endif
+			return SinCosScalar;
+		}
+	}
+
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC pop_options
+#endif
+
+	// sines[i] = sin(radians[i]) and cosines[i] = cos(radians[i]) for count angles, 8 at a time with AVX2, 4 with SSE2, or one by one, whichever the CPU supports
+	// results are within 1.2e-7 of the exact values (|x| up to 8192, std::sin/std::cos past that) and the same with every instruction set
+	inline void SinCos(const float* radians, float* sines, float* cosines, size_t count) {
+		static const detail::SinCosFunction implementation = detail::SelectSinCos();
+		implementation(radians, sines, cosines, count);
+	}
+}
+
+#endif // SIMD_HPP
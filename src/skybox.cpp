@@ -68,7 +68,7 @@ namespace cs381 {
 		// We are inside the cube, we need to disable backface culling!
 		rlDisableBackfaceCulling();
 		rlDisableDepthMask();
-			cube.Draw({});
+			cube.Draw(raylib::Vector3::Zero());
 		rlEnableBackfaceCulling();
 		rlEnableDepthMask();
 
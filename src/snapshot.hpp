@@ -0,0 +1,285 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <span>
+#include <string>
+#include <vector>
+#include "ECS.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define CS381_SNAPSHOT_MMAP 1
+#endif
+
+namespace cs381 {
+
+	// binary snapshot of a Scene<ComponentStorage>, laid out so the file can be mapped and its columns used in place:
+	//     SnapshotHeader
+	//     SnapshotColumn[componentCount]		one per component, in the saving build's component ID order
+	//     entity masks							one Signature per slot
+	//     generations							one Entity per slot
+	//     free list							one uint64_t per free slot
+	//     component columns					the raw bytes of every storage
+	// every section starts on a 64-byte boundary; components are matched by ComponentHash, so builds that reorder
+	// the ComponentRegistry can still load each other's snapshots (the file is native endian, and components are saved byte for byte, so they
+	// must not hold pointers: refer to resources by an index into a table the program rebuilds on every run instead)
+	constexpr uint32_t SnapshotVersion = 1;
+	constexpr size_t SnapshotAlignment = 64;
+
+	struct SnapshotHeader {
+		char magic[8] = {'C', 'S', '3', '8', '1', 'S', 'N', 'P'};
+		uint32_t version = SnapshotVersion;
+		uint32_t componentCount = 0;
+		uint64_t slots = 0;						// entity slots, live or free
+		uint64_t freeCount = 0;
+		uint64_t masks = 0;						// section offsets from the start of the file
+		uint64_t generations = 0;
+		uint64_t freeList = 0;
+		uint64_t size = 0;						// total file size, catches truncated files
+	};
+	static_assert(sizeof(SnapshotHeader) == SnapshotAlignment);
+
+	struct SnapshotColumn {
+		uint64_t hash;							// ComponentHash of the component
+		uint64_t elementSize;					// 0 for tag components, which have no column
+		uint64_t offset;
+		uint64_t bytes;
+	};
+
+	constexpr uint64_t SnapshotAlign(uint64_t offset) { return (offset + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment; }
+
+	template<typename... Tcomponents>
+	constexpr bool Snapshottable(ComponentList<Tcomponents...>) { return (std::is_trivially_copyable_v<Tcomponents> && ...); }
+
+	// writes every storage and mask of scene to path, returns false if the file couldn't be written
+	template<typename Storage> requires std::same_as<Storage, ComponentStorage>	// the snapshot stores slot indexed columns, which only the flat storage has
+	bool SaveSnapshot(Scene<Storage>& scene, const std::string& path) {
+		static_assert(Snapshottable(RegisteredComponents<Storage>{}), "components are saved as raw bytes, so they must be trivially copyable");
+		constexpr auto& hashes = RegisteredComponents<Storage>::hashes;
+
+		SnapshotHeader header;
+		header.componentCount = hashes.size();
+		header.slots = scene.entityMasks.size();
+		header.freeCount = scene.entities.freeList.size();
+		header.masks = SnapshotAlign(sizeof(SnapshotHeader) + hashes.size() * sizeof(SnapshotColumn));
+		header.generations = SnapshotAlign(header.masks + header.slots * sizeof(Signature));
+		header.freeList = SnapshotAlign(header.generations + header.slots * sizeof(Entity));
+		uint64_t offset = SnapshotAlign(header.freeList + header.freeCount * sizeof(uint64_t));
+
+		std::vector<SnapshotColumn> columns(hashes.size());
+		for(size_t id = 0; id < hashes.size(); id++) {
+			auto& storage = scene.storages[id];
+			bool tag = storage.elementSize == size_t(-1);
+			columns[id] = {hashes[id], tag ? 0 : storage.elementSize, offset, tag ? 0 : storage.data.size()};
+			offset = SnapshotAlign(offset + columns[id].bytes);
+		}
+		header.size = offset;
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if(!file) return false;
+		auto write = [&](const void* data, size_t bytes, uint64_t at) {	// pads up to at, then writes
+			static constexpr char zeros[SnapshotAlignment] = {};
+			file.write(zeros, at - file.tellp());
+			file.write((const char*)data, bytes);
+		};
+		std::vector<uint64_t> freeList(scene.entities.freeList.begin(), scene.entities.freeList.end());
+		write(&header, sizeof(header), 0);
+		write(columns.data(), columns.size() * sizeof(SnapshotColumn), sizeof(header));
+		write(scene.entityMasks.data(), header.slots * sizeof(Signature), header.masks);
+		write(scene.entities.generations.data(), header.slots * sizeof(Entity), header.generations);
+		write(freeList.data(), freeList.size() * sizeof(uint64_t), header.freeList);
+		for(size_t id = 0; id < hashes.size(); id++)
+			write(scene.storages[id].data.data(), columns[id].bytes, columns[id].offset);
+		write(nullptr, 0, header.size);
+		return bool(file);
+	}
+
+	// a snapshot file mapped into memory (read into an aligned buffer where mmap isn't available)
+	// its sections can be read in place, or copied into a scene with Load
+	struct SnapshotFile {
+		const std::byte* bytes = nullptr;
+		size_t size = 0;
+
+		SnapshotFile() = default;
+		SnapshotFile(const std::string& path) { Open(path); }
+		SnapshotFile(const SnapshotFile&) = delete;
+		~SnapshotFile() { Close(); }
+
+		// maps path and validates its header and section table, returns false (leaving the file closed) if it isn't a usable snapshot
+		bool Open(const std::string& path) {
+			Close();
+#ifdef CS381_SNAPSHOT_MMAP
+			int fd = open(path.c_str(), O_RDONLY);
+			if(fd < 0) return false;
+			struct stat info;
+			if(fstat(fd, &info) == 0 && info.st_size > 0) {
+				void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(mapped != MAP_FAILED) {
+					bytes = (const std::byte*)mapped;
+					size = info.st_size;
+				}
+			}
+			close(fd);														// the mapping stays valid after the descriptor is closed
+#else
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if(!file) return false;
+			size = file.tellg();
+			std::byte* buffer = (std::byte*)::operator new(size, std::align_val_t(SnapshotAlignment));
+			file.seekg(0);
+			file.read((char*)buffer, size);
+			bytes = buffer;
+			if(!file) Close();
+#endif
+			if(!Valid()) Close();
+			return bytes != nullptr;
+		}
+
+		void Close() {
+			if(!bytes) return;
+#ifdef CS381_SNAPSHOT_MMAP
+			munmap((void*)bytes, size);
+#else
+			::operator delete((void*)bytes, std::align_val_t(SnapshotAlignment));
+#endif
+			bytes = nullptr;
+			size = 0;
+		}
+
+		bool IsOpen() const { return bytes != nullptr; }
+
+		const SnapshotHeader& Header() const { return *(const SnapshotHeader*)bytes; }
+		std::span<const SnapshotColumn> Columns() const { return {(const SnapshotColumn*)(bytes + sizeof(SnapshotHeader)), Header().componentCount}; }
+		std::span<const Signature> Masks() const { return {(const Signature*)(bytes + Header().masks), Header().slots}; }
+		std::span<const Entity> Generations() const { return {(const Entity*)(bytes + Header().generations), Header().slots}; }
+		std::span<const uint64_t> FreeList() const { return {(const uint64_t*)(bytes + Header().freeList), Header().freeCount}; }
+
+		const SnapshotColumn* Find(uint64_t hash) const {
+			for(auto& column: Columns())
+				if(column.hash == hash) return &column;
+			return nullptr;
+		}
+
+		// a component's column used in place, indexed by entity slot (it may be shorter than Masks() when the last slots never had the component)
+		template<typename Tcomponent>
+		std::span<const Tcomponent> Column() const {
+			const SnapshotColumn* column = Find(ComponentHash<Tcomponent>());
+			if(!column || column->elementSize != sizeof(Tcomponent)) return {};
+			return {(const Tcomponent*)(bytes + column->offset), column->bytes / sizeof(Tcomponent)};
+		}
+
+		// replaces the contents of scene with the snapshot, one memcpy per storage
+		// returns false (leaving scene untouched) if a component's size differs from the one saved
+		// components missing from the snapshot end up on no entity, components only in the snapshot are dropped
+		// every component counts as added for Added/Changed filters, and registered queries are rebuilt so existing Query views stay valid
+		template<typename Storage> requires std::same_as<Storage, ComponentStorage>
+		bool Load(Scene<Storage>& scene) const {
+			if(!IsOpen()) return false;
+			constexpr auto& hashes = RegisteredComponents<Storage>::hashes;
+			std::vector<const SnapshotColumn*> columns(hashes.size());
+			for(size_t id = 0; id < hashes.size(); id++) {
+				columns[id] = Find(hashes[id]);
+				bool tag = scene.storages[id].elementSize == size_t(-1);
+				if(columns[id] && columns[id]->elementSize != (tag ? 0 : scene.storages[id].elementSize))
+					return false;
+			}
+
+			auto masks = Masks();
+			std::vector<size_t> remap(Header().componentCount, Signature::AliveBit);	// saved component ID -> our ID (AliveBit when we don't have it)
+			bool identity = Header().componentCount == hashes.size();
+			for(size_t saved = 0; saved < remap.size(); saved++) {
+				for(size_t id = 0; id < hashes.size(); id++)
+					if(Columns()[saved].hash == hashes[id]) remap[saved] = id;
+				identity &= remap[saved] == saved;
+			}
+			if(identity)
+				scene.entityMasks.assign(masks.begin(), masks.end());
+			else {
+				scene.entityMasks.resize(masks.size());
+				for(size_t index = 0; index < masks.size(); index++) {
+					Signature mask = masks[index].test(Signature::AliveBit) ? Signature::Alive() : Signature{};
+					for(size_t saved = 0; saved < remap.size(); saved++)
+						if(masks[index].test(saved) && remap[saved] != Signature::AliveBit) mask.set(remap[saved]);
+					scene.entityMasks[index] = mask;
+				}
+			}
+
+			auto generations = Generations();
+			auto freeList = FreeList();
+			scene.entities.generations.assign(generations.begin(), generations.end());
+			scene.entities.freeList.assign(freeList.begin(), freeList.end());
+
+			for(size_t id = 0; id < hashes.size(); id++) {
+				auto& storage = scene.storages[id];
+				if(storage.elementSize == size_t(-1)) continue;
+				if(columns[id])
+					storage.data.assign(bytes + columns[id]->offset, bytes + columns[id]->offset + columns[id]->bytes);
+				else storage.data.clear();
+			}
+
+			scene.changes.MarkAllAdded(hashes.size(), masks.size());
+			for(auto& query: scene.queries)
+				scene.Fill(query);
+			return true;
+		}
+
+	private:
+		bool Valid() const {
+			if(!bytes || size < sizeof(SnapshotHeader)) return false;
+			auto& header = Header();
+			if(std::memcmp(header.magic, SnapshotHeader{}.magic, sizeof(header.magic)) != 0 || header.version != SnapshotVersion
+				|| header.size > size || header.componentCount > MaxComponents || header.slots > size || header.freeCount > size)	// keeps the products below from overflowing
+				return false;
+			if(sizeof(SnapshotHeader) + header.componentCount * sizeof(SnapshotColumn) > header.masks
+				|| header.masks + header.slots * sizeof(Signature) > header.size
+				|| header.generations + header.slots * sizeof(Entity) > header.size
+				|| header.freeList + header.freeCount * sizeof(uint64_t) > header.size)
+				return false;
+			for(auto& column: Columns())
+				if(column.offset % SnapshotAlignment != 0 || column.offset > header.size || column.bytes > header.size - column.offset
+					|| (column.elementSize && column.bytes % column.elementSize != 0))
+					return false;
+			if(header.masks % SnapshotAlignment != 0 || header.generations % SnapshotAlignment != 0 || header.freeList % SnapshotAlignment != 0)
+				return false;
+
+			// the sections have to agree with each other too, Load copies them into a scene that indexes columns by the masks' bits and hands out free slots as they are
+			std::vector<std::pair<uint64_t, size_t>> ends;						// (slots the column has room for, component), tags have no column and room for any slot
+			for(size_t id = 0; id < header.componentCount; id++)
+				if(Columns()[id].elementSize) ends.push_back({Columns()[id].bytes / Columns()[id].elementSize, id});
+			std::sort(ends.begin(), ends.end());
+			uint64_t outside = ~uint64_t(0) << header.componentCount & ~Signature::Alive().bits;	// components no slot from here on can have
+			auto masks = Masks();
+			for(size_t index = 0, next = 0; index < masks.size(); index++) {
+				for(; next < ends.size() && ends[next].first <= index; next++)
+					outside |= uint64_t(1) << ends[next].second;
+				if(masks[index].bits & outside) return false;
+			}
+			std::vector<bool> listed(header.slots);								// a slot listed twice would be handed to two entities
+			for(uint64_t slot: FreeList()) {
+				if(slot >= header.slots || listed[slot] || !(Generations()[slot] & EntityAllocator::FreeSlot) || masks[slot].test(Signature::AliveBit))
+					return false;
+				listed[slot] = true;
+			}
+			for(size_t index = 0; index < masks.size(); index++)
+				if(masks[index].test(Signature::AliveBit) && (Generations()[index] & EntityAllocator::FreeSlot))
+					return false;
+			return true;
+		}
+	};
+
+	// loads the snapshot at path into scene, false if the file is missing, corrupt, or doesn't match the scene's components
+	template<typename Storage> requires std::same_as<Storage, ComponentStorage>
+	bool LoadSnapshot(Scene<Storage>& scene, const std::string& path) {
+		SnapshotFile file;
+		return file.Open(path) && file.Load(scene);
+	}
+}
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,134 @@
+#ifndef SPATIAL_HPP
+#define SPATIAL_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "ECS.hpp"
+#include "jobs.hpp"
+
+namespace cs381 {
+
+	// uniform grid over the XZ plane for proximity queries; cells are hashed into a table, so the world needs no bounds
+	// it is rebuilt every tick: Clear, Insert every point, then Build lays them out with a counting sort so the items of a cell sit next to each other
+	struct SpatialHash {
+		struct Item {
+			Entity entity;
+			float x, z;
+			int32_t cellX, cellZ;											// tells apart cells that share a bucket
+		};
+
+		struct Pair {
+			Entity a, b;
+		};
+
+		float cellSize;
+		std::vector<Item> points;											// inserted since Clear, in insertion order
+		std::vector<Item> items;											// points sorted by bucket, bucket b holds items[bucketStart[b], bucketStart[b + 1])
+		std::vector<uint32_t> bucketStart;
+		std::vector<uint32_t> bucketOf;										// Build's scratch space
+		int shift = 58;														// 64 - log2(bucket count)
+
+		explicit SpatialHash(float cellSize = 4) : cellSize(cellSize) {}
+
+		void Clear() { points.clear(); }
+		void Insert(Entity e, float x, float z) { points.push_back({e, x, z, Cell(x), Cell(z)}); }
+
+		// sorts the inserted points into buckets, with about twice as many buckets as points; stable, so equal inputs give equal layouts
+		void Build() {
+			size_t buckets = std::bit_ceil(std::max<size_t>(points.size() * 2, 64));
+			shift = 64 - std::countr_zero(buckets);
+			bucketStart.assign(buckets + 1, 0);
+			bucketOf.resize(points.size());
+			for(size_t i = 0; i < points.size(); i++) {
+				bucketOf[i] = Bucket(points[i].cellX, points[i].cellZ);
+				bucketStart[bucketOf[i] + 1]++;
+			}
+			for(size_t b = 0; b < buckets; b++)
+				bucketStart[b + 1] += bucketStart[b];
+			items.resize(points.size());
+			for(size_t i = 0; i < points.size(); i++)
+				items[bucketStart[bucketOf[i]]++] = points[i];				// leaves bucketStart[b] at the end of bucket b...
+			for(size_t b = buckets; b > 0; b--)
+				bucketStart[b] = bucketStart[b - 1];						// ...which is where bucket b + 1 starts
+			bucketStart[0] = 0;
+		}
+
+		// calls fn(item) for every item with minX <= x <= maxX and minZ <= z <= maxZ
+		template<typename F>
+		void ForEachInBox(float minX, float minZ, float maxX, float maxZ, F&& fn) const {
+			auto inside = [&](const Item& item) { return item.x >= minX && item.x <= maxX && item.z >= minZ && item.z <= maxZ; };
+			int32_t x0 = Cell(minX), x1 = Cell(maxX), z0 = Cell(minZ), z1 = Cell(maxZ);
+			if(int64_t(x1 - x0 + 1) * int64_t(z1 - z0 + 1) > int64_t(items.size())) {	// more cells than items, scanning them all is cheaper
+				for(auto& item: items)
+					if(inside(item)) fn(item);
+				return;
+			}
+			for(int32_t cx = x0; cx <= x1; cx++)
+				for(int32_t cz = z0; cz <= z1; cz++) {
+					size_t bucket = Bucket(cx, cz);
+					for(size_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++)
+						if(items[i].cellX == cx && items[i].cellZ == cz && inside(items[i])) fn(items[i]);
+				}
+		}
+
+		// calls fn(item) for every item within radius of (x, z)
+		template<typename F>
+		void ForEachInRadius(float x, float z, float radius, F&& fn) const {
+			ForEachInBox(x - radius, z - radius, x + radius, z + radius, [&](const Item& item) {
+				float dx = item.x - x, dz = item.z - z;
+				if(dx * dx + dz * dz <= radius * radius) fn(item);
+			});
+		}
+
+		// appends every pair of items at most distance apart, each pair once; distance may not exceed cellSize, so only neighbouring cells need looking at
+		void FindPairs(float distance, std::vector<Pair>& pairs) const {
+			FindPairsIn(distance, 0, items.size(), pairs);
+		}
+
+		// FindPairs spread over the job system in ranges of grain items, the pairs come out in the same order as FindPairs gives them
+		void ParallelFindPairs(float distance, std::vector<Pair>& pairs, size_t grain = 4096, JobSystem& jobs = JobSystem::Default()) const {
+			size_t chunks = (items.size() + grain - 1) / grain;
+			std::vector<std::vector<Pair>> found(chunks);
+			jobs.ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+				for(size_t chunk = begin; chunk < end; chunk++)
+					FindPairsIn(distance, chunk * grain, std::min(items.size(), (chunk + 1) * grain), found[chunk]);
+			});
+			for(auto& chunk: found)
+				pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+		}
+
+		int32_t Cell(float coordinate) const { return int32_t(std::clamp(std::floor(coordinate / cellSize), -1e9f, 1e9f)); }
+
+		size_t Bucket(int32_t cellX, int32_t cellZ) const {
+			uint64_t key = uint64_t(uint32_t(cellX)) << 32 | uint32_t(cellZ);
+			return (key * 0x9E3779B97F4A7C15ull) >> shift;				// Fibonacci hashing, the top bits are the best mixed
+		}
+
+	private:
+		void FindPairsIn(float distance, size_t begin, size_t end, std::vector<Pair>& pairs) const {
+			static constexpr int32_t forward[][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};	// half the neighbours, the other half find us instead
+			float distance2 = distance * distance;
+			auto test = [&](const Item& a, const Item& b) {
+				float dx = b.x - a.x, dz = b.z - a.z;
+				if(dx * dx + dz * dz <= distance2) pairs.push_back({a.entity, b.entity});
+			};
+			for(size_t i = begin; i < end; i++) {
+				const Item& item = items[i];
+				size_t bucket = Bucket(item.cellX, item.cellZ);
+				for(size_t j = i + 1; j < bucketStart[bucket + 1]; j++)			// the rest of its own cell
+					if(items[j].cellX == item.cellX && items[j].cellZ == item.cellZ) test(item, items[j]);
+				for(auto [dx, dz]: forward) {
+					int32_t cx = item.cellX + dx, cz = item.cellZ + dz;
+					size_t neighbour = Bucket(cx, cz);
+					for(size_t j = bucketStart[neighbour]; j < bucketStart[neighbour + 1]; j++)
+						if(items[j].cellX == cx && items[j].cellZ == cz) test(item, items[j]);
+				}
+			}
+		}
+	};
+}
+
+#endif // SPATIAL_HPP
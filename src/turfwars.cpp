@@ -1,47 +1,65 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
+#include <array>
+#include <span>
+#include <chrono>
+#include <cstdlib>
 #include "raylib-cpp.hpp"
 #include "skybox.hpp"
 #include "ECS.hpp"
+#include "hierarchy.hpp"
+#include "scheduler.hpp"
+#include "pipeline.hpp"
+#include "simd.hpp"
+#include "spatial.hpp"
+#include "collision.hpp"
+#include "snapshot.hpp"
+#include "events.hpp"
+#include "clock.hpp"
 #include "BufferedRaylib.hpp"
 
-size_t globalComponentCounter = 0;
+struct RenderComponent;
+struct KinematicsComponent;
+struct Physics2DComponent;
+struct ColliderComponent;
+struct GrassComponent;
 
-template<typename T>
-concept Transformer = requires(T t, raylib::Matrix m)
-{
-    { t(m) } -> std::convertible_to<raylib::Matrix>;
-};
+// component IDs are positions in this list, keep the order stable
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<TransformComponent, RenderComponent, KinematicsComponent, Physics2DComponent, ParentComponent, ChildrenComponent, WorldTransformComponent, PreviousTransformComponent, ColliderComponent, GrassComponent> {};
 
-void DrawBoundedModel(raylib::Model& model, auto transformer)
+// draws with an explicit model matrix, model.transform isn't touched so the same model can be drawn from several places at once
+void DrawBoundedModel(const raylib::Model& model, const raylib::Matrix& matrix)
 {
-    raylib::Matrix backup = model.transform;                    // Stores the current transformation matrix of the model in a variable, `backup`
-    model.transform = transformer(backup);                      // Calls the transformer function, passing in the current transform into `backup`
-    model.Draw({});        
-    model.GetTransformedBoundingBox().Draw(raylib::RAYWHITE);   // Draws the bounding box of the model
-    model.transform = backup;                                   // Restores the model’s original transformation matrix from the backup
+    model.Draw(matrix);
+    model.GetTransformedBoundingBox(matrix).Draw(raylib::RAYWHITE);   // Draws the bounding box of the model
 }
 
-void DrawModel(raylib::Model& model, auto transformer)
+void DrawModel(const raylib::Model& model, const raylib::Matrix& matrix)
 {
-    raylib::Matrix backup = model.transform;                    
-    model.transform = transformer(backup);
-    model.Draw({});
-    model.transform = backup;
+    model.Draw(matrix);
 }
 
-struct TransformComponent
+// models are referred to by their position in the table main loads them into, so RenderComponent holds no pointers and snapshots stay valid from one run to the next
+enum ModelID : uint32_t
 {
-    raylib::Vector3 position = {0, 0, 0};
-    float heading = 0.0f;
+    SedanModel,
+    TaxiModel,
+    RaceCarModel,
+    WheelModel,
+    RacingWheelModel,
+    RocketModel,
+    ModelCount,
+    NoModel = ~uint32_t(0),
 };
 
 struct RenderComponent
 {
-    raylib::Model* model = nullptr;
+    uint32_t model = NoModel;       // a ModelID
     bool showBoundingBox = false;
     bool isRocket = false;
+    ::Matrix matrix = raylib::Matrix::Identity();   // model matrix the model is drawn with, cached by RenderSystem
 
     void ToggleBoundingBox()
     {
@@ -49,57 +67,101 @@ struct RenderComponent
     }
 };
 
-void RenderSystem(cs381::Scene<cs381::ComponentStorage>& scene, float dt)
+// models are only ever scaled uniformly (main sets their transform to Identity().Scale(modelSize)), so one entry holds the whole scale
+float ModelScale(const raylib::Model& model)
+{
+    return model.transform.m5;
+}
+
+// the same matrix as Identity().Scale(scale) * TransformMatrix({0, 0, 0}, 90.0f) * world, turning a model to face down x only swaps world's axes around
+raylib::Matrix FaceForwardMatrix(const ::Matrix& world, float scale)
+{
+    return raylib::Matrix(
+        -scale * world.m8,  scale * world.m4, scale * world.m0, world.m12,
+        -scale * world.m9,  scale * world.m5, scale * world.m1, world.m13,
+        -scale * world.m10, scale * world.m6, scale * world.m2, world.m14,
+        0.0f,               0.0f,             0.0f,             1.0f);
+}
+
+// the same matrix as Identity().Scale(scale) * CreateRotateZ(roll) * CreateTranslate(position), built directly from one sincos
+raylib::Matrix RollMatrix(raylib::Vector3 position, float roll, float scale)
+{
+    float sine = std::sin(roll * DEG2RAD);
+    float cosine = std::cos(roll * DEG2RAD);
+    return raylib::Matrix(
+        scale * cosine, -scale * sine,  0.0f,  position.x,
+        scale * sine,   scale * cosine, 0.0f,  position.y,
+        0.0f,           0.0f,           scale, position.z,
+        0.0f,           0.0f,           0.0f,  1.0f);
+}
+
+void RenderSystem(cs381::Scene<cs381::ComponentStorage>& scene, std::span<raylib::Model* const> models, float dt)
 {
-    for (cs381::Entity e = 0; e < scene.entityMasks.size(); ++e)
+    auto modelOf = [&](const RenderComponent& render) { return render.model < models.size() ? models[render.model] : nullptr; };
+
+    // entities placed by the transform hierarchy keep their model matrix until their world transform changes
+    scene.GetQuery<WorldTransformComponent, RenderComponent>().ForEach<cs381::Changed<WorldTransformComponent>>([&](cs381::Entity e, WorldTransformComponent& world, RenderComponent& render)
     {
-        if (!scene.HasComponent<TransformComponent>(e)) continue;
-        if (!scene.HasComponent<RenderComponent>(e)) continue;
+        raylib::Model* model = modelOf(render);
+        if (model == nullptr || render.isRocket) return;
+        render.matrix = FaceForwardMatrix(world.matrix, ModelScale(*model));
+    });
 
-        auto& transform = scene.GetComponent<TransformComponent>(e);
-        auto& render = scene.GetComponent<RenderComponent>(e);
+    scene.GetQuery<TransformComponent, RenderComponent>().ForEach([&](cs381::Entity e, TransformComponent& transform, RenderComponent& render)
+    {
+        raylib::Model* model = modelOf(render);
+        if (model == nullptr) return;
 
-        if (render.model == nullptr) continue;
+        if (render.isRocket)
+        {
+            render.matrix = RollMatrix(transform.position, transform.heading, ModelScale(*model));
+        }
+        else if (!scene.HasComponent<WorldTransformComponent>(e))
+        {
+            render.matrix = TransformMatrix(transform.position, transform.heading + 90.0f, ModelScale(*model));     // models face down x
+        }
 
         if (render.showBoundingBox)
         {
-            DrawBoundedModel(*render.model, [&](raylib::Matrix& matrix)
-            {
-                if (render.isRocket)
-                {
-                    return matrix.Translate(transform.position).RotateZ(raylib::Degree(transform.heading));
-                }
-                else
-                {
-                    return matrix.Translate(transform.position).RotateY(raylib::Degree(transform.heading) + raylib::Degree(90));
-                }
-            });
+            DrawBoundedModel(*model, render.matrix);
         }
         else
         {
-            DrawModel(*render.model, [&](raylib::Matrix& matrix)
-            {
-                if (render.isRocket)
-                {
-                    return matrix.Translate(transform.position).RotateZ(raylib::Degree(transform.heading));
-                }
-                else
-                {
-                    return matrix.Translate(transform.position).RotateY(raylib::Degree(transform.heading) + raylib::Degree(90));
-                }
-            });
+            DrawModel(*model, render.matrix);
         }
-    }
+    });
 }
 
-struct KinematicsComponent
+// game events, systems push them while they run and listeners handle them once the frame's systems have finished
+struct OutOfBoundsEvent
+{
+    cs381::Entity entity;
+    raylib::Vector3 position;
+};
+
+struct GrassExitEvent
+{
+    cs381::Entity entity;
+    float timeOnGrass;
+};
+
+struct CollisionEvent
+{
+    cs381::Entity a;
+    cs381::Entity b;
+    raylib::Vector3 point;
+};
+
+using GameEvents = cs381::EventBus<OutOfBoundsEvent, GrassExitEvent, CollisionEvent>;
+
+// 32 bytes apart in the storage: with the 28 the fields take, GCC can't vectorize KinematicsKernel's loops
+struct alignas(32) KinematicsComponent
 {
     raylib::Vector3 velocity = {0.0f, 0.0f, 0.0f}; 
     float speed = 0.0f;
     float targetSpeed = 0.0f;      
     float acceleration = 0.0f;                    
     float maxSpeed = 0.0f; 
-    float timeOnGrass = 0.0f;                 
 
     void AdjustSpeed(bool increase)
     {
@@ -114,43 +176,100 @@ struct KinematicsComponent
     }
 };
 
-void KinematicsSystem(cs381::Scene<cs381::ComponentStorage>& scene, float dt, bool& gameRunning)
+// kinematics and 2D physics both update every car's transform, so they run fused in one pass over the cars (see the Movement system in main)
+// a block of cars is updated with straight loops over the component spans, which the compiler can vectorize: slots in the block missing either
+// component step by 0 rather than branching, and speeds and positions are updated in separate loops so neither array can alias the other
+struct KinematicsKernel : cs381::Kernel<TransformComponent, KinematicsComponent>
 {
-    for (cs381::Entity e = 0; e < scene.entityMasks.size(); ++e)
-    {
-        if (!scene.HasComponent<TransformComponent>(e)) continue;
-        if (!scene.HasComponent<KinematicsComponent>(e)) continue;
+    GameEvents* events;
+    float dt;
 
-        auto& transform = scene.GetComponent<TransformComponent>(e);
-        auto& kinematics = scene.GetComponent<KinematicsComponent>(e);
+    void Batch(cs381::Scene<cs381::ComponentStorage>& scene, std::span<const size_t> indices) const
+    {
+        auto transforms = scene.Span<TransformComponent>();
+        auto kinematics = scene.Span<KinematicsComponent>();
+        auto masks = std::span(scene.entityMasks);
+        constexpr auto required = cs381::MakeSignature<TransformComponent, KinematicsComponent>();
+        size_t begin = indices.front(), end = indices.back() + 1;     // both spans reach the last car of the block
+        float decay = 1.0f - std::min(4.0f * dt, 1.0f);
 
-        if (kinematics.targetSpeed < kinematics.maxSpeed)
+        std::array<float, 64> cars;     // 1 for the block's slots holding a car, 0 for the others
+        for (size_t i = begin; i < end; i++)
         {
-            kinematics.targetSpeed += kinematics.acceleration * dt;
+            cars[i - begin] = masks[i].Contains(required);
         }
 
-        kinematics.speed = std::lerp(kinematics.speed, kinematics.targetSpeed, dt);
+        for (size_t i = begin; i < end; i++)
+        {
+            auto& k = kinematics[i];
+            float car = cars[i - begin];
+            float step = car * dt;
+            k.targetSpeed += float(k.targetSpeed < k.maxSpeed) * k.acceleration * step;
+            k.speed += (k.targetSpeed - k.speed) * step;
+
+            // knock-back from collisions (see CollisionSystem) dies down within a second or so, scale is 1 for slots that aren't cars
+            float lengthSqr = k.velocity.x * k.velocity.x + k.velocity.y * k.velocity.y + k.velocity.z * k.velocity.z;
+            float scale = lengthSqr > 0.0001f ? decay : 0.0f;
+            scale = car * scale + (1.0f - car);
+            k.velocity.x *= scale;
+            k.velocity.y *= scale;
+            k.velocity.z *= scale;
+        }
 
-        transform.position.x += kinematics.velocity.x * dt;
-        transform.position.y += kinematics.velocity.y * dt;
-        transform.position.z += kinematics.velocity.z * dt;
+        for (size_t i = begin; i < end; i++)
+        {
+            float step = cars[i - begin] * dt;
+            raylib::Vector3 velocity = kinematics[i].velocity;
+            auto& position = transforms[i].position;
+            position.x += velocity.x * step;
+            position.y += velocity.y * step;
+            position.z += velocity.z * step;
+        }
 
-        if (std::abs(transform.position.x) > 50 || std::abs(transform.position.z) > 50)
+        // branchy bookkeeping stays out of the loops above
+        for (size_t i : indices)
         {
-            std::cout << "Entity " << e << " is out of bounds!" << std::endl;
-            gameRunning = false;
-            return;
+            cs381::Entity e = scene.GetEntity(i);
+            auto& velocity = kinematics[i].velocity;
+            auto& position = transforms[i].position;
+            if (velocity.x != 0 || velocity.y != 0 || velocity.z != 0)
+            {
+                scene.MarkChanged<TransformComponent>(e);
+            }
+
+            if (std::abs(position.x) > 50 || std::abs(position.z) > 50)
+            {
+                events->Push(OutOfBoundsEvent{e, position});
+            }
         }
     }
+};
+
+// runs at the start of every simulation tick, before anything moves
+void PreviousTransformSystem(cs381::Scene<cs381::ComponentStorage>& scene)
+{
+    scene.GetQuery<TransformComponent, PreviousTransformComponent>().ForEach([&](cs381::Entity e, TransformComponent& transform, PreviousTransformComponent& previous)
+    {
+        if (previous.position == transform.position && previous.heading == transform.heading) return;
+        previous = {transform.position, transform.heading};
+        scene.MarkChanged<PreviousTransformComponent>(e);   // lets the hierarchy settle the entity once it stops moving
+    });
 }
 
-void GrassTrackingSystem(cs381::Scene<cs381::ComponentStorage>& scene, cs381::Entity selectedEntity, float dt)
+// how long a car has spent on the grass, kept apart from KinematicsComponent so that GrassTracking doesn't conflict with the systems reading kinematics
+struct GrassComponent
+{
+    float timeOnGrass = 0.0f;
+    bool onGrass = false;
+};
+
+void GrassTrackingSystem(cs381::Scene<cs381::ComponentStorage>& scene, cs381::Entity selectedEntity, float dt, GameEvents& events)
 {
     if (!scene.HasComponent<TransformComponent>(selectedEntity)) return;
-    if (!scene.HasComponent<KinematicsComponent>(selectedEntity)) return;
+    if (!scene.HasComponent<GrassComponent>(selectedEntity)) return;
 
     auto& transform = scene.GetComponent<TransformComponent>(selectedEntity);
-    auto& kinematics = scene.GetComponent<KinematicsComponent>(selectedEntity);
+    auto& grass = scene.GetComponent<GrassComponent>(selectedEntity);
 
 
     bool isOnGrass = (transform.position.x > -50 && transform.position.x < 50 &&
@@ -158,10 +277,178 @@ void GrassTrackingSystem(cs381::Scene<cs381::ComponentStorage>& scene, cs381::En
 
     if (isOnGrass)
     {
-        kinematics.timeOnGrass += dt; 
+        grass.timeOnGrass += dt; 
+    }
+    else if (grass.onGrass)
+    {
+        events.Push(GrassExitEvent{selectedEntity, grass.timeOnGrass});
+    }
+    grass.onGrass = isOnGrass;
+}
+
+// cars closer than this may be touching: twice the bounding circle of the longest car body (the taxi, 1.5 by 2.75 model units, scaled by 3)
+constexpr float CarContactDistance = 9.4f;
+
+// rebuilds the spatial hash from every car's position and collects the pairs of cars close enough to touch
+// parallel spreads the pair search over the job system, both ways find the same pairs in the same order
+void BroadphaseSystem(cs381::Scene<cs381::ComponentStorage>& scene, cs381::SpatialHash& grid, std::vector<cs381::SpatialHash::Pair>& pairs, bool parallel = true)
+{
+    grid.Clear();
+    scene.GetQuery<TransformComponent, ColliderComponent>().ForEach([&](cs381::Entity e, TransformComponent& transform, ColliderComponent&)
+    {
+        grid.Insert(e, transform.position.x, transform.position.z);
+    });
+    grid.Build();
+    pairs.clear();
+    if (parallel)
+    {
+        grid.ParallelFindPairs(CarContactDistance, pairs);
+    }
+    else
+    {
+        grid.FindPairs(CarContactDistance, pairs);
     }
 }
 
+// the car body as a box on the ground, in world units along the car's forward and side axes
+// an entity with a collider but no KinematicsComponent is a static obstacle: cars bounce off it and it never moves
+struct ColliderComponent
+{
+    float halfLength = 0.0f;
+    float halfWidth = 0.0f;
+    float inverseMass = 1.0f;   // 0 for cars nothing can push
+};
+
+// resolves overlapping cars: the broadphase's pairs are tested box against box, the touching ones are split into islands
+// (groups of cars pushing on each other) solved in parallel, then the new velocities and positions are written back
+// a car's velocity is its heading times its speed plus its knock-back, the part of the result along the heading goes back into the speed
+// with parallel off every step runs on the calling thread and the contacts are solved in one list; islands share no bodies, so the results are the same
+struct CollisionSystem
+{
+    static constexpr uint32_t None = ~uint32_t(0);
+
+    bool parallel = true;
+    cs381::ContactSettings settings;
+    std::vector<cs381::Contact> contacts;
+    std::vector<uint8_t> touching;
+    std::vector<cs381::ContactBody> bodies;
+    std::vector<cs381::Entity> bodyEntities;
+    std::vector<uint32_t> bodyOf;               // entity slot -> body, None for cars that aren't touching anything
+    std::vector<cs381::OrientedBox> boxes;      // entity slot -> the car's box this tick, worked out once however many pairs the car is in
+    cs381::ContactIslands islands;
+
+    void Run(cs381::Scene<cs381::ComponentStorage>& scene, std::span<const cs381::SpatialHash::Pair> pairs, GameEvents& events)
+    {
+        boxes.resize(scene.entityMasks.size());
+        auto box = [&](cs381::Entity e, TransformComponent& transform, ColliderComponent& collider)
+        {
+            float sine = std::sin(transform.heading * DEG2RAD);
+            float cosine = std::cos(transform.heading * DEG2RAD);
+            boxes[cs381::EntityIndex(e)] = {transform.position.x, transform.position.z, cosine, -sine, collider.halfLength, collider.halfWidth};
+        };
+        if (parallel)
+        {
+            scene.GetQuery<TransformComponent, ColliderComponent>().ParallelForEach(box);
+        }
+        else
+        {
+            scene.GetQuery<TransformComponent, ColliderComponent>().ForEach(box);
+        }
+
+        // narrowphase, pairs are independent so they spread over the job system
+        contacts.resize(pairs.size());
+        touching.assign(pairs.size(), false);
+        auto narrowphase = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto [a, b] = pairs[i];
+                if (!scene.HasComponent<ColliderComponent>(a) || !scene.HasComponent<ColliderComponent>(b)) continue;
+                touching[i] = cs381::BoxesOverlap(boxes[cs381::EntityIndex(a)], boxes[cs381::EntityIndex(b)], contacts[i].normalX, contacts[i].normalZ, contacts[i].depth);
+            }
+        };
+        if (parallel)
+        {
+            cs381::JobSystem::Default().ParallelFor(pairs.size(), 1024, narrowphase);
+        }
+        else
+        {
+            narrowphase(0, pairs.size());
+        }
+
+        // the touching cars become solver bodies, numbered in order of first contact
+        bodyOf.resize(scene.entityMasks.size(), None);
+        bodies.clear();
+        bodyEntities.clear();
+        size_t count = 0;
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            if (!touching[i]) continue;
+            contacts[count] = contacts[i];
+            contacts[count].a = Body(scene, pairs[i].a);
+            contacts[count].b = Body(scene, pairs[i].b);
+            count++;
+        }
+        contacts.resize(count);
+
+        if (parallel)
+        {
+            islands.Build(contacts, bodies.size());
+            islands.Solve(contacts, bodies, settings);
+        }
+        else
+        {
+            cs381::SolveContacts(contacts, bodies, settings);
+        }
+
+        for (auto& contact : contacts)
+        {
+            if (contact.bias == 0) continue;    // only impacts hard enough to bounce are reported, not cars resting against each other
+            auto& a = scene.GetComponent<TransformComponent>(bodyEntities[contact.a]);
+            auto& b = scene.GetComponent<TransformComponent>(bodyEntities[contact.b]);
+            events.Push(CollisionEvent{bodyEntities[contact.a], bodyEntities[contact.b], (a.position + b.position) / 2});
+        }
+
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            cs381::Entity e = bodyEntities[i];
+            bodyOf[cs381::EntityIndex(e)] = None;
+            if (!scene.HasComponent<KinematicsComponent>(e)) continue;     // static colliders never move
+            auto& transform = scene.GetComponent<TransformComponent>(e);
+            auto& kinematics = scene.GetComponent<KinematicsComponent>(e);
+            auto& box = boxes[cs381::EntityIndex(e)];
+            raylib::Vector2 forward = {box.forwardX, box.forwardZ};
+            raylib::Vector2 velocity = {bodies[i].velocityX, bodies[i].velocityZ};
+            kinematics.speed = velocity.DotProduct(forward);
+            kinematics.velocity = raylib::Vector3(velocity.x - forward.x * kinematics.speed, 0.0f, velocity.y - forward.y * kinematics.speed);
+            transform.position.x += bodies[i].correctionX;
+            transform.position.z += bodies[i].correctionZ;
+            scene.MarkChanged<TransformComponent>(e);
+        }
+    }
+
+    uint32_t Body(cs381::Scene<cs381::ComponentStorage>& scene, cs381::Entity e)
+    {
+        uint32_t& body = bodyOf[cs381::EntityIndex(e)];
+        if (body == None)
+        {
+            body = bodies.size();
+            if (scene.HasComponent<KinematicsComponent>(e))
+            {
+                auto& box = boxes[cs381::EntityIndex(e)];
+                auto& kinematics = scene.GetComponent<KinematicsComponent>(e);
+                bodies.push_back({box.forwardX * kinematics.speed + kinematics.velocity.x, box.forwardZ * kinematics.speed + kinematics.velocity.z, scene.GetComponent<ColliderComponent>(e).inverseMass});
+            }
+            else
+            {
+                bodies.push_back({0.0f, 0.0f, 0.0f});       // a collider without kinematics is a wall: it stands still and nothing can push it
+            }
+            bodyEntities.push_back(e);
+        }
+        return body;
+    }
+};
+
 struct Physics2DComponent
 {
     raylib::Vector3 velocity = {0.0f, 0.0f, 0.0f};
@@ -176,33 +463,303 @@ struct Physics2DComponent
     }
 };
 
-void Physics2DSystem(cs381::Scene<cs381::ComponentStorage>& scene, float dt)
+// runs a block of up to 64 cars at a time: their headings are gathered into one array so the sines and cosines come out of a single SIMD pass,
+// which is most of the cost of a tick with many cars
+struct Physics2DKernel : cs381::Kernel<TransformComponent, Physics2DComponent, const KinematicsComponent>
 {
-    for (cs381::Entity e = 0; e < scene.entityMasks.size(); ++e)
+    float dt;
+
+    void Batch(cs381::Scene<cs381::ComponentStorage>& scene, std::span<const size_t> indices) const
     {
-        if (!scene.HasComponent<TransformComponent>(e)) continue;
-        if (!scene.HasComponent<Physics2DComponent>(e)) continue;
-        if (!scene.HasComponent<KinematicsComponent>(e)) continue;
+        std::array<float, 64> radians{}, sines{}, cosines{};
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            radians[i] = scene.GetComponentAt<TransformComponent>(indices[i]).heading * DEG2RAD;
+        }
+        cs381::SinCos(radians.data(), sines.data(), cosines.data(), indices.size());
 
-        auto& transform = scene.GetComponent<TransformComponent>(e);
-        auto& physics2D = scene.GetComponent<Physics2DComponent>(e);
-        auto& kinematics = scene.GetComponent<KinematicsComponent>(e);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            auto& transform = scene.GetComponentAt<TransformComponent>(indices[i]);
+            auto& physics2D = scene.GetComponentAt<Physics2DComponent>(indices[i]);
+            auto& kinematics = scene.GetComponentAt<const KinematicsComponent>(indices[i]);
 
-        physics2D.velocity.x = cos(transform.heading * DEG2RAD) * kinematics.speed;
-        physics2D.velocity.z = -sin(transform.heading * DEG2RAD) * kinematics.speed;
-        
-        transform.position.x += physics2D.velocity.x * dt;
-        transform.position.z += physics2D.velocity.z * dt;
+            physics2D.velocity.x = cosines[i] * kinematics.speed;
+            physics2D.velocity.z = -sines[i] * kinematics.speed;
 
-        physics2D.currentRotation = transform.heading;
-        physics2D.currentRotation = std::lerp(physics2D.currentRotation, physics2D.targetHeading, dt);
-        transform.heading = physics2D.currentRotation;
+            transform.position.x += physics2D.velocity.x * dt;
+            transform.position.z += physics2D.velocity.z * dt;
+
+            physics2D.currentRotation = transform.heading;
+            physics2D.currentRotation = std::lerp(physics2D.currentRotation, physics2D.targetHeading, dt);
+            bool moved = kinematics.speed != 0 || transform.heading != physics2D.currentRotation;
+            transform.heading = physics2D.currentRotation;
+
+            if (moved)  // parked cars keep their old change stamp, so Changed<TransformComponent> queries skip them
+            {
+                scene.MarkChanged<TransformComponent>(scene.GetEntity(indices[i]));
+            }
+        }
     }
+};
+
+void PrintSceneStats(const cs381::SceneStats& stats)
+{
+    std::cout << std::left << std::setw(26) << "component" << std::right << std::setw(8) << "size" << std::setw(8) << "live" << std::setw(8) << "stored"
+              << std::setw(12) << "bytes" << std::setw(12) << "wasted" << std::setw(10) << "frag %" << "\n";
+    for (auto& component : stats.components)
+    {
+        std::cout << std::left << std::setw(26) << component.name << std::right << std::setw(8) << component.elementSize << std::setw(8) << component.live
+                  << std::setw(8) << component.stored << std::setw(12) << component.capacityBytes + component.indexBytes << std::setw(12) << component.wastedBytes
+                  << std::setw(10) << std::fixed << std::setprecision(1) << component.fragmentation * 100 << "\n";
+    }
+    std::cout << stats.entities << " entities in " << stats.slots << " slots (" << stats.freeSlots << " free), masks " << stats.maskBytes
+              << " B, queries " << stats.queryBytes << " B, change ticks " << stats.changeBytes << " B, total " << stats.TotalBytes() << " B" << std::endl;
+}
+
+// the cars every game starts with
+std::vector<cs381::Entity> SpawnCars(cs381::Scene<cs381::ComponentStorage>& scene, const std::array<ModelID, 3>& models, float modelSize)
+{
+    float turnRates[] = {7.0f, 8.0f, 10.0f};
+    raylib::Vector2 bodyExtents[] = {{1.275f, 0.75f}, {1.375f, 0.75f}, {1.28f, 0.6f}};     // half the car bodies' length and width in model units
+    return scene.Spawn<TransformComponent, RenderComponent, KinematicsComponent, Physics2DComponent, WorldTransformComponent, PreviousTransformComponent, ColliderComponent, GrassComponent>(3, [&](size_t i, cs381::Entity e, TransformComponent& transform, RenderComponent& render, KinematicsComponent& kinematics, Physics2DComponent& physics2D, WorldTransformComponent&, PreviousTransformComponent& previous, ColliderComponent& collider, GrassComponent&)
+    {
+        transform = {{-20, 0, -10 - 5.0f * i}, 0.0f};
+        previous = {transform.position, transform.heading};
+        render = {models[i], i == 0, false};
+        kinematics = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 3.0f, 100.0f};
+        physics2D = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, turnRates[i], 0.0f};
+        collider = {bodyExtents[i].x * modelSize, bodyExtents[i].y * modelSize, 1.0f};
+    });
 }
 
-int main()
+// four wheel entities per car, children of the car so they follow it, placed where the car models have their wheels
+void SpawnWheels(cs381::Scene<cs381::ComponentStorage>& scene, TransformHierarchy& hierarchy, const std::vector<cs381::Entity>& cars, const std::array<ModelID, 3>& models, float modelSize)
+{
+    raylib::Vector3 wheelOffsets[][4] = {
+        {{0.3f, 0.3f, 0.66f}, {-0.3f, 0.3f, 0.66f}, {0.3f, 0.3f, -0.66f}, {-0.3f, 0.3f, -0.66f}},
+        {{0.3f, 0.3f, 0.76f}, {-0.3f, 0.3f, 0.76f}, {0.3f, 0.3f, -0.76f}, {-0.3f, 0.3f, -0.76f}},
+        {{0.35f, 0.3f, 0.64f}, {-0.35f, 0.3f, 0.64f}, {0.35f, 0.3f, -0.88f}, {-0.35f, 0.3f, -0.88f}},
+    };
+    auto wheels = scene.Spawn<TransformComponent, RenderComponent, WorldTransformComponent>(4 * cars.size(), [&](size_t i, cs381::Entity e, TransformComponent& transform, RenderComponent& render, WorldTransformComponent&)
+    {
+        // offsets are in model space, which is scaled and turned 90 degrees from the car's own space
+        transform = {(wheelOffsets[i / 4][i % 4] * modelSize).Transform(raylib::Matrix::CreateRotateY(raylib::Degree(90))), 0.0f};
+        render = {models[i / 4], false, false};
+    });
+    for (size_t i = 0; i < wheels.size(); i++)
+    {
+        hierarchy.SetParent(scene, wheels[i], cars[i / 4]);
+    }
+}
+
+// the first live car in the slots after the one given (wrapping around, so the given slot comes last), InvalidEntity if there are no cars
+cs381::Entity NextCar(cs381::Scene<cs381::ComponentStorage>& scene, size_t after)
+{
+    size_t slots = scene.entityMasks.size();
+    for (size_t i = 1; i <= slots; i++)
+    {
+        cs381::Entity e = scene.GetEntity((after + i) % slots);
+        if (scene.HasComponent<KinematicsComponent>(e)) return e;    // only cars can be driven
+    }
+    return cs381::InvalidEntity;
+}
+
+// what a player can do, applied between simulation ticks so that a session can be recorded and replayed tick for tick
+enum class CarAction : uint8_t
+{
+    Select,
+    Accelerate,
+    Decelerate,
+    TurnLeft,
+    TurnRight,
+};
+constexpr std::string_view CarActionNames[] = {"select", "accelerate", "decelerate", "left", "right"};
+
+struct InputRecord
+{
+    uint64_t tick;              // the action happens right before this tick runs
+    uint32_t car;               // position in the list SpawnCars returned
+    CarAction action;
+};
+
+void ApplyCarAction(cs381::Scene<cs381::ComponentStorage>& scene, cs381::Entity car, CarAction action)
+{
+    if (action == CarAction::Accelerate || action == CarAction::Decelerate)
+    {
+        if (scene.HasComponent<KinematicsComponent>(car))
+        {
+            scene.GetComponent<KinematicsComponent>(car).AdjustSpeed(action == CarAction::Accelerate);
+        }
+    }
+    else if (action == CarAction::TurnLeft || action == CarAction::TurnRight)
+    {
+        if (scene.HasComponent<Physics2DComponent>(car))
+        {
+            scene.GetComponent<Physics2DComponent>(car).AdjustHeading(action == CarAction::TurnLeft);
+        }
+    }
+}
+
+// input scripts hold one record per line, "tick car action" (e.g. "240 0 accelerate"), lines starting with # are comments
+// they can be written by hand or recorded from a game with --record
+bool LoadInputScript(const std::string& path, std::vector<InputRecord>& records)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        InputRecord record;
+        std::string name;
+        if (!(fields >> record.tick >> record.car >> name)) return false;
+        auto found = std::find(std::begin(CarActionNames), std::end(CarActionNames), name);
+        if (found == std::end(CarActionNames)) return false;
+        record.action = CarAction(found - std::begin(CarActionNames));
+        records.push_back(record);
+    }
+    std::stable_sort(records.begin(), records.end(), [](const InputRecord& a, const InputRecord& b) { return a.tick < b.tick; });
+    return true;
+}
+
+bool SaveInputScript(const std::string& path, const std::vector<InputRecord>& records)
+{
+    std::ofstream file(path);
+    file << "# tick car action\n";
+    for (auto& record : records)
+    {
+        file << record.tick << ' ' << record.car << ' ' << CarActionNames[size_t(record.action)] << '\n';
+    }
+    return bool(file);
+}
+
+// runs the simulation without a window, audio device or any GL call, one fixed tick after another as fast as the CPU allows
+int RunHeadless(double seconds, const std::string& scriptPath)
+{
+    std::vector<InputRecord> script;
+    if (!scriptPath.empty() && !LoadInputScript(scriptPath, script))
+    {
+        std::cout << "Failed to load input script " << scriptPath << std::endl;
+        return 1;
+    }
+
+    // the same entities as the game, so recorded scripts and snapshots line up
+    cs381::Scene<cs381::ComponentStorage> scene;
+    auto cars = SpawnCars(scene, {SedanModel, TaxiModel, RaceCarModel}, 3);
+    TransformHierarchy hierarchy;
+    SpawnWheels(scene, hierarchy, cars, {WheelModel, WheelModel, RacingWheelModel}, 3);
+    cs381::Entity selectedEntity = cars[0];
+
+    cs381::FixedClock clock(120);
+    float dt = clock.Step();
+    bool running = true;
+    GameEvents events;
+    events.Listen<OutOfBoundsEvent>([&](const OutOfBoundsEvent& event)
+    {
+        if (!running) return;   // every car past the edge reports, the first one ends the run
+        std::cout << "Entity " << cs381::EntityIndex(event.entity) << " is out of bounds at " << clock.Time() << " s\n";
+        running = false;
+    });
+    events.Listen<GrassExitEvent>([&](const GrassExitEvent& event)
+    {
+        std::cout << "Entity " << cs381::EntityIndex(event.entity) << " left the grass after " << event.timeOnGrass << " seconds\n";
+    });
+    cs381::SpatialHash grid(CarContactDistance);
+    std::vector<cs381::SpatialHash::Pair> nearbyCars;
+    CollisionSystem collisions;
+    collisions.parallel = false;
+    size_t collisionCount = 0;
+    events.Listen<CollisionEvent>([&](const CollisionEvent&) { collisionCount++; });
+
+    // the systems run one after another on this thread, broadphase and collisions on their serial paths: with a handful of entities, handing them to the job system costs more than they do
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    while (running && clock.Time() < seconds)
+    {
+        for (; next < script.size() && script[next].tick <= clock.ticks; next++)
+        {
+            auto [tick, car, action] = script[next];
+            if (car >= cars.size()) continue;
+            if (action == CarAction::Select)
+            {
+                selectedEntity = cars[car];
+            }
+            else
+            {
+                ApplyCarAction(scene, cars[car], action);
+            }
+        }
+
+        clock.Advance(clock.step);      // synthetic clock, every iteration is exactly one tick
+        PreviousTransformSystem(scene);
+        cs381::Pipeline(KinematicsKernel{{}, &events, dt}, Physics2DKernel{{}, dt}).Run(scene);
+        GrassTrackingSystem(scene, selectedEntity, dt, events);
+        BroadphaseSystem(scene, grid, nearbyCars, false);
+        collisions.Run(scene, nearbyCars, events);
+        events.Dispatch();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Simulated " << clock.Time() << " s (" << clock.ticks << " ticks) in " << elapsed << " s, " << clock.Time() / std::max(elapsed, 1e-9) << "x real time, "
+              << collisionCount << " collisions\n";
+    for (size_t i = 0; i < cars.size(); i++)
+    {
+        auto& transform = scene.GetComponent<TransformComponent>(cars[i]);
+        auto& kinematics = scene.GetComponent<KinematicsComponent>(cars[i]);
+        auto& grass = scene.GetComponent<GrassComponent>(cars[i]);
+        std::cout << "Car " << i << ": position (" << transform.position.x << ", " << transform.position.z << "), heading " << transform.heading
+                  << ", speed " << kinematics.speed << ", time on grass " << grass.timeOnGrass << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
 {
     srand(static_cast<unsigned int>(time(NULL)));
+
+    bool headless = false;
+    double headlessSeconds = 60;
+    std::string scriptPath;
+    std::string recordPath;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                headlessSeconds = std::atof(argv[++i]);
+            }
+        }
+        else if (arg == "--script" && i + 1 < argc)
+        {
+            scriptPath = argv[++i];
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else
+        {
+            std::cout << "usage: turfwars [--headless [seconds]] [--script inputs.txt] [--record inputs.txt]" << std::endl;
+            return 1;
+        }
+    }
+    if (headless)
+    {
+        return RunHeadless(headlessSeconds, scriptPath);
+    }
+
+    std::vector<InputRecord> script;
+    if (!scriptPath.empty() && !LoadInputScript(scriptPath, script))
+    {
+        std::cout << "Failed to load input script " << scriptPath << std::endl;
+        return 1;
+    }
+
     // window setup
     int screenWidth = 800;
     int screenHeight = 600;
@@ -226,7 +783,11 @@ int main()
     taxi.transform = raylib::Matrix::Identity().Scale(modelSize);
     auto rocket = raylib::Model("meshes/rocketA.glb");
     rocket.transform = raylib::Matrix::Identity().Scale(modelSize);
-
+    auto wheel = raylib::Model("meshes/wheel-default.glb");
+    wheel.transform = raylib::Matrix::Identity().Scale(modelSize);
+    auto racingWheel = raylib::Model("meshes/wheel-racing.glb");
+    racingWheel.transform = raylib::Matrix::Identity().Scale(modelSize);
+    std::array<raylib::Model*, ModelCount> models = {&sedan, &taxi, &raceCar, &wheel, &racingWheel, &rocket};     // indexed by ModelID
 
     raylib::Model grass = raylib::Mesh::Plane(100, 100, 1, 1).LoadModelFrom();
     raylib::Texture grassTexture = raylib::Texture("../assets/textures/grass.jpg");
@@ -253,33 +814,35 @@ int main()
     // scene
     cs381::Scene<cs381::ComponentStorage> scene;
 
-    auto sedan1 = scene.CreateEntity();
-    auto taxi1 = scene.CreateEntity();
-    auto raceCar1 = scene.CreateEntity();
-
-    scene.AddComponent<TransformComponent>(sedan1) = {{-20, 0, -10}, 0.0f};
-    scene.AddComponent<TransformComponent>(taxi1) = {{-20, 0, -15}, 0.0f};
-    scene.AddComponent<TransformComponent>(raceCar1) = {{-20, 0, -20}, 0.0f};
+    auto cars = SpawnCars(scene, {SedanModel, TaxiModel, RaceCarModel}, modelSize);
+    auto sedan1 = cars[0];
 
-    scene.AddComponent<RenderComponent>(sedan1) = {&sedan, true, false};
-    scene.AddComponent<RenderComponent>(taxi1) = {&taxi, false, false};
-    scene.AddComponent<RenderComponent>(raceCar1) = {&raceCar, false, false};
+    TransformHierarchy hierarchy;
+    SpawnWheels(scene, hierarchy, cars, {WheelModel, WheelModel, RacingWheelModel}, modelSize);
+    hierarchy.Propagate(scene);
 
-    scene.AddComponent<KinematicsComponent>(sedan1) = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 3.0f, 100.0f};
-    scene.AddComponent<KinematicsComponent>(taxi1) = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 3.0f, 100.0f};
-    scene.AddComponent<KinematicsComponent>(raceCar1) = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 3.0f, 100.0f};
-
-    scene.AddComponent<Physics2DComponent>(sedan1) = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 7.0f, 0.0f};
-    scene.AddComponent<Physics2DComponent>(taxi1) = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 8.0f, 0.0f};
-    scene.AddComponent<Physics2DComponent>(raceCar1) = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 10.0f, 0.0f};
+    // the simulation runs at a fixed 120 ticks per second whatever the frame rate, rendering interpolates between the last two ticks
+    cs381::FixedClock clock(120);
+    float dt = clock.Step();
 
     // buffred input setup
     raylib::BufferedInput input;
 
     cs381::Entity selectedEntity = sedan1;
 
+    // every action goes through drive, which records it (with the tick it lands on) when --record was given
+    std::vector<InputRecord> recording;
+    auto drive = [&](CarAction action)
+    {
+        ApplyCarAction(scene, selectedEntity, action);
+        if (!recordPath.empty())
+        {
+            recording.push_back({clock.ticks, uint32_t(std::find(cars.begin(), cars.end(), selectedEntity) - cars.begin()), action});
+        }
+    };
+
     input["select"] = raylib::Action::button(raylib::Button::key(KEY_TAB));
-    input["select"].AddCallback([&scene, &selectedEntity](float state, float change) 
+    input["select"].AddCallback([&scene, &selectedEntity, &drive](float state, float change) 
     {
         if (state == 1) 
         {
@@ -288,7 +851,10 @@ int main()
                 scene.GetComponent<RenderComponent>(selectedEntity).showBoundingBox = false;
             }
 
-            selectedEntity = (selectedEntity + 1) % scene.entityMasks.size();
+            cs381::Entity next = NextCar(scene, cs381::EntityIndex(selectedEntity));
+            if (next == cs381::InvalidEntity) return;
+            selectedEntity = next;
+            drive(CarAction::Select);
 
             if (scene.HasComponent<RenderComponent>(selectedEntity)) 
             {
@@ -298,71 +864,170 @@ int main()
     });
 
     input["move_forward"] = raylib::Action::button(raylib::Button::key(KEY_W));
-    input["move_forward"].AddCallback([&scene, &selectedEntity](float state, float change) 
+    input["move_forward"].AddCallback([&drive](float state, float change) 
     {
-        if (state == 1 && scene.HasComponent<KinematicsComponent>(selectedEntity)) 
+        if (state == 1) 
         {
-            scene.GetComponent<KinematicsComponent>(selectedEntity).AdjustSpeed(true);
+            drive(CarAction::Accelerate);
         }
     });
 
     input["move_backward"] = raylib::Action::button(raylib::Button::key(KEY_S));
-    input["move_backward"].AddCallback([&scene, &selectedEntity](float state, float change) 
+    input["move_backward"].AddCallback([&drive](float state, float change) 
     {
-        if (state == 1 && scene.HasComponent<KinematicsComponent>(selectedEntity)) 
+        if (state == 1) 
         {
-            scene.GetComponent<KinematicsComponent>(selectedEntity).AdjustSpeed(false);
+            drive(CarAction::Decelerate);
         }
     });
 
     input["turn_left"] = raylib::Action::button(raylib::Button::key(KEY_A));
-    input["turn_left"].AddCallback([&scene, &selectedEntity](float state, float change) 
+    input["turn_left"].AddCallback([&drive](float state, float change) 
     {
-        if (state == 1 && scene.HasComponent<Physics2DComponent>(selectedEntity)) 
+        if (state == 1) 
         {
-            scene.GetComponent<Physics2DComponent>(selectedEntity).AdjustHeading(true);
+            drive(CarAction::TurnLeft);
         }
     });
 
     input["turn_right"] = raylib::Action::button(raylib::Button::key(KEY_D));
-    input["turn_right"].AddCallback([&scene, &selectedEntity](float state, float change) 
+    input["turn_right"].AddCallback([&drive](float state, float change) 
+    {
+        if (state == 1) 
+        {
+            drive(CarAction::TurnRight);
+        }
+    });
+    
+    // quicksave / quickload, loading waits for the start of the next frame since references into the scene are held during this one
+    bool loadRequested = false;
+
+    input["save"] = raylib::Action::button(raylib::Button::key(KEY_F5));
+    input["save"].AddCallback([&scene](float state, float change) 
+    {
+        if (state == 1 && !cs381::SaveSnapshot(scene, "turfwars.snapshot"))
+        {
+            std::cout << "Failed to save turfwars.snapshot" << std::endl;
+        }
+    });
+
+    input["stats"] = raylib::Action::button(raylib::Button::key(KEY_F3));
+    input["stats"].AddCallback([&scene](float state, float change) 
+    {
+        if (state == 1)
+        {
+            PrintSceneStats(scene.Stats());
+        }
+    });
+
+    input["load"] = raylib::Action::button(raylib::Button::key(KEY_F9));
+    input["load"].AddCallback([&loadRequested](float state, float change) 
     {
-        if (state == 1 && scene.HasComponent<Physics2DComponent>(selectedEntity)) 
+        if (state == 1)
         {
-            scene.GetComponent<Physics2DComponent>(selectedEntity).AdjustHeading(false);
+            loadRequested = true;
         }
     });
+
+    // systems report what happened through events, which are handled on this thread after every frame's systems finish
+    GameEvents events;
+    events.Listen<OutOfBoundsEvent>([&gameRunning](const OutOfBoundsEvent& event)
+    {
+        if (!gameRunning) return;   // every car past the edge reports, the first one ends the game
+        std::cout << "Entity " << cs381::EntityIndex(event.entity) << " is out of bounds!\n";
+        gameRunning = false;
+    });
+    events.Listen<GrassExitEvent>([](const GrassExitEvent& event)
+    {
+        std::cout << "Entity " << cs381::EntityIndex(event.entity) << " left the grass after " << event.timeOnGrass << " seconds\n";
+    });
+    // cars bounce off each other several times in a row while they push through a jam, so impacts are reported at most once per simulated second
+    double nextImpactReport = 0;
+    events.Listen<CollisionEvent>([&clock, &nextImpactReport](const CollisionEvent& event)
+    {
+        if (clock.Time() < nextImpactReport) return;
+        nextImpactReport = clock.Time() + 1.0;
+        std::cout << "Entity " << cs381::EntityIndex(event.a) << " hit entity " << cs381::EntityIndex(event.b) << "\n";
+    });
+
+    // simulation systems that don't touch the same components run in parallel: PreviousTransform, Movement and Collision each depend on the one before,
+    // GrassTracking and Broadphase only read transforms so they run side by side between Movement and Collision
+    // pushing events is thread safe, so systems that push declare GameEvents as a read, only Dispatch (between ticks) writes the bus
+    cs381::Scheduler simulation;
+    simulation.Add("PreviousTransform", cs381::Reads<TransformComponent>{}, cs381::Writes<PreviousTransformComponent>{}, [&] { PreviousTransformSystem(scene); });
+    simulation.Add("Movement", cs381::Reads<GameEvents>{}, cs381::Writes<TransformComponent, KinematicsComponent, Physics2DComponent>{}, [&]
+    {
+        cs381::Pipeline(KinematicsKernel{{}, &events, dt}, Physics2DKernel{{}, dt}).ParallelRun(scene);
+    });
+    simulation.Add("GrassTracking", cs381::Reads<TransformComponent, GameEvents>{}, cs381::Writes<GrassComponent>{}, [&] { GrassTrackingSystem(scene, selectedEntity, dt, events); });
+    cs381::SpatialHash grid(CarContactDistance);
+    std::vector<cs381::SpatialHash::Pair> nearbyCars;     // pairs of cars close enough to touch, refreshed every tick
+    simulation.Add("Broadphase", cs381::Reads<TransformComponent, ColliderComponent>{}, cs381::Writes<cs381::SpatialHash>{}, [&] { BroadphaseSystem(scene, grid, nearbyCars); });
+    CollisionSystem collisions;
+    simulation.Add("Collision", cs381::Reads<cs381::SpatialHash, ColliderComponent, GameEvents>{}, cs381::Writes<TransformComponent, KinematicsComponent, CollisionSystem>{}, [&] { collisions.Run(scene, nearbyCars, events); });
     
+    size_t nextScripted = 0;
     while (!window.ShouldClose())
     {
-        auto& kinematics = scene.GetComponent<KinematicsComponent>(selectedEntity);
+        if (loadRequested)
+        {
+            loadRequested = false;
+            if (!cs381::LoadSnapshot(scene, "turfwars.snapshot"))
+            {
+                std::cout << "Failed to load turfwars.snapshot" << std::endl;
+            }
+            hierarchy.rebuild = true;
+            if (!scene.HasComponent<KinematicsComponent>(selectedEntity))   // the snapshot's cars aren't necessarily ours
+            {
+                selectedEntity = NextCar(scene, scene.entityMasks.size() - 1);
+                if (scene.HasComponent<RenderComponent>(selectedEntity))
+                {
+                    scene.GetComponent<RenderComponent>(selectedEntity).showBoundingBox = true;
+                }
+            }
+        }
 
         if (gameRunning)
         {
             input.PollEvents();
-            window.BeginDrawing();
             wind.Update();
+
+            for (size_t steps = clock.Advance(window.GetFrameTime()); steps > 0 && gameRunning; steps--)
+            {
+                for (; nextScripted < script.size() && script[nextScripted].tick <= clock.ticks - steps; nextScripted++)    // the tick about to run
+                {
+                    auto [tick, car, action] = script[nextScripted];
+                    if (car >= cars.size()) continue;
+                    if (action == CarAction::Select)
+                    {
+                        selectedEntity = cars[car];
+                    }
+                    else
+                    {
+                        ApplyCarAction(scene, cars[car], action);
+                    }
+                }
+                simulation.Run();
+                events.Dispatch();
+            }
+            hierarchy.Propagate(scene, clock.Alpha());
+
+            window.BeginDrawing();
             {
                 window.ClearBackground(WHITE);
                 camera.BeginMode();
                     sky.Draw();
-                    grass.Draw({});
-
-                    auto dt = window.GetFrameTime();
-                    RenderSystem(scene, dt);
-                    KinematicsSystem(scene, dt, gameRunning);
-                    Physics2DSystem(scene, dt);
-                    GrassTrackingSystem(scene, selectedEntity, dt);
-
+                    grass.Draw(raylib::Vector3::Zero());
+                    RenderSystem(scene, models, window.GetFrameTime());
                 camera.EndMode();
 
                 raylib::DrawText(("FPS: " + std::to_string(window.GetFPS())).c_str(), 10, 10, 20, GREEN);
 
-                if (scene.HasComponent<KinematicsComponent>(selectedEntity))
+                if (scene.HasComponent<GrassComponent>(selectedEntity))
                 {
                     std::string label = "Time on Grass: ";
                     std::ostringstream timeStream;
-                    timeStream << std::fixed << std::setprecision(3) << std::setw(6) << kinematics.timeOnGrass;
+                    timeStream << std::fixed << std::setprecision(3) << std::setw(6) << scene.GetComponent<GrassComponent>(selectedEntity).timeOnGrass;
                     std::string timeText = label + timeStream.str();
                     int labelWidth = MeasureText(label.c_str(), 20);
                     int numberWidth = MeasureText("000.000", 20);
@@ -377,12 +1042,18 @@ int main()
             window.BeginDrawing();
             {
                 window.ClearBackground(BLACK);
-                std::string gameOverText = "Game Over! Time on Grass (sec): " + std::to_string(kinematics.timeOnGrass);
+                float timeOnGrass = scene.HasComponent<GrassComponent>(selectedEntity) ? scene.GetComponent<GrassComponent>(selectedEntity).timeOnGrass : 0.0f;
+                std::string gameOverText = "Game Over! Time on Grass (sec): " + std::to_string(timeOnGrass);
                 raylib::DrawText(gameOverText.c_str(), screenWidth / 2 - MeasureText(gameOverText.c_str(), 20) / 2, screenHeight / 2 - 10, 20, WHITE);
                 raylib::DrawText("Press ESC to Exit", screenWidth / 2 - MeasureText("Press ESC to Exit", 20) / 2, screenHeight / 2 + 20, 20, RED);
             }
             window.EndDrawing();
         }
     }
+
+    if (!recordPath.empty() && !SaveInputScript(recordPath, recording))
+    {
+        std::cout << "Failed to save input recording " << recordPath << std::endl;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <vector>
+#include "pipeline.hpp"
+#include "check.hpp"
+
+struct Position { float x, y, z, w; };
+struct Velocity { float x, y, z, w; };
+struct Frozen {};
+struct Unused { double value[3]; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Velocity, Frozen, Unused> {};
+
+using Scene = cs381::Scene<cs381::ArchetypeStorage>;
+
+struct MoveKernel : cs381::Kernel<Position, const Velocity> {
+	void operator()(cs381::Entity, Position& position, const Velocity& velocity) const { position.x += velocity.x; }
+};
+
+const cs381::ArchetypeStorage::Archetype& ArchetypeOf(Scene& scene, cs381::Entity e) {
+	return scene.storage.archetypes[scene.storage.locations[cs381::EntityIndex(e)].archetype];
+}
+
+size_t CountPositions(Scene& scene) {
+	size_t count = 0;
+	scene.ForEach<Position>([&](cs381::Entity, Position&) { count++; });
+	return count;
+}
+
+int main() {
+	Scene scene;
+	constexpr size_t Count = 2000;											// a few chunks in every archetype below
+	std::vector<cs381::Entity> entities;
+	for(size_t i = 0; i < Count; i++) {
+		entities.push_back(scene.CreateEntity());
+		scene.AddComponent<Position>(entities.back()) = {float(i), 0, 0, 0};
+	}
+	CHECK(ArchetypeOf(scene, entities[0]).chunks.size() > 2);
+
+	// adding and removing components moves entities between archetypes, carrying the components they keep
+	for(size_t i = 0; i < Count; i += 2)
+		scene.AddComponent<Velocity>(entities[i]) = {1, 0, 0, float(i)};
+	for(size_t i = 0; i < Count; i += 4)
+		scene.RemoveComponent<Velocity>(entities[i]);
+	scene.AddComponent<Frozen>(entities[1]);
+	CHECK(ArchetypeOf(scene, entities[2]).chunks.size() > 1 && ArchetypeOf(scene, entities[2]).signature == (cs381::MakeSignature<Position, Velocity>()));
+	CHECK(ArchetypeOf(scene, entities[1]).signature == (cs381::MakeSignature<Position, Frozen>()));
+	for(size_t i = 0; i < Count; i++) {
+		CHECK(scene.GetComponent<Position>(entities[i]).x == float(i));
+		CHECK(scene.HasComponent<Velocity>(entities[i]) == (i % 4 == 2));
+		if(i % 4 == 2) CHECK(scene.GetComponent<Velocity>(entities[i]).w == float(i));
+	}
+
+	// destroying drops the entity's row (the archetype's last row moves into it), the slot goes to the next entity created
+	for(size_t i = 0; i < Count; i += 3)
+		scene.DestroyEntity(entities[i]);
+	CHECK(CountPositions(scene) == Count - (Count + 2) / 3);
+	for(size_t i = 0; i < Count; i++) {
+		CHECK(scene.IsAlive(entities[i]) == (i % 3 != 0));
+		if(i % 3 != 0) CHECK(scene.GetComponent<Position>(entities[i]).x == float(i));
+	}
+	cs381::Entity reused = scene.CreateEntity();
+	CHECK(!scene.IsAlive(entities[Count - 2]) && cs381::EntityIndex(reused) == cs381::EntityIndex(entities[Count - 2]));
+	CHECK(!scene.HasComponent<Position>(reused) && !scene.HasComponent<Position>(entities[Count - 2]));
+	scene.DestroyEntity(entities[Count - 2]);								// stale handle, leaves the slot's new owner alone
+	CHECK(scene.IsAlive(reused));
+
+	// spawned entities go straight into their archetype, reusing the remaining free slots first
+	auto spawned = scene.Spawn<Position, Velocity>(Count, [](size_t i, cs381::Entity, Position& position, Velocity& velocity) {
+		position = {-float(i), 0, 0, 0};
+		velocity = {2, 0, 0, 0};
+	});
+	CHECK(cs381::EntityIndex(spawned[0]) < Count && scene.entityMasks.size() < 2 * Count);
+	for(size_t i = 0; i < Count; i++)
+		CHECK(scene.GetComponent<Position>(spawned[i]).x == -float(i) && scene.GetComponent<Velocity>(spawned[i]).x == 2);
+
+	// ForEach and ParallelForEach visit every matching entity once, whichever chunk it sits in
+	size_t moving = 0;
+	float sum = 0;
+	scene.ForEach<Position, Velocity>([&](cs381::Entity, Position&, Velocity& velocity) {
+		moving++;
+		sum += velocity.x;
+	});
+	auto query = scene.GetQuery<Position, Velocity>();
+	CHECK(moving == query.size() && sum == 2 * Count + (moving - Count));
+	std::atomic<size_t> visited = 0;
+	query.ParallelForEach([&](cs381::Entity, Position& position, Velocity&) {
+		position.y += 1;
+		visited++;
+	});
+	CHECK(visited == moving);
+	size_t once = 0;
+	scene.ForEach<Position>([&](cs381::Entity e, Position& position) {
+		CHECK(position.y == (scene.HasComponent<Velocity>(e) ? 1 : 0));
+		once++;
+	});
+	CHECK(once == CountPositions(scene));
+
+	// pipelines run on it through GetComponentAt, a fork copies every chunk
+	Scene fork = scene.Fork();
+	cs381::Pipeline(MoveKernel{}).Run(fork);
+	CHECK(fork.GetComponent<Position>(spawned[5]).x == -5 + 2 && scene.GetComponent<Position>(spawned[5]).x == -5);
+	CHECK(fork.GetComponent<Position>(entities[2]).x == 2 + 1 && fork.GetComponent<Position>(entities[1]).x == 1);
+
+	// every component reports its size, including one no archetype holds yet; tags take none
+	auto stats = scene.Stats();
+	CHECK(stats.components[cs381::GetComponentID<Unused>()].elementSize == sizeof(Unused) && stats.components[cs381::GetComponentID<Unused>()].capacityBytes == 0);
+	CHECK(stats.components[cs381::GetComponentID<Position>()].elementSize == sizeof(Position) && stats.components[cs381::GetComponentID<Frozen>()].elementSize == 0);
+	CHECK(stats.components[cs381::GetComponentID<Position>()].live == CountPositions(scene) && stats.entities == CountPositions(scene) + 1);
+	return 0;
+}
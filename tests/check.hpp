@@ -0,0 +1,15 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+// an assert that stays on in release builds, every test is a plain executable that fails by exiting non-zero
+#define CHECK(condition) do { \
+		if(!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			std::exit(1); \
+		} \
+	} while(false)
+
+#endif // CHECK_HPP
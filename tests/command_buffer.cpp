@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <vector>
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x; };
+struct Velocity { float x; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Velocity> {};
+
+// the entities a Changed<Position> filter visits, sorted
+template<typename Tscene>
+std::vector<cs381::Entity> ChangedPositions(Tscene& scene) {
+	std::vector<cs381::Entity> out;
+	scene.template GetQuery<Position>().template ForEach<cs381::Changed<Position>>([&](cs381::Entity e, Position&) { out.push_back(e); });
+	std::sort(out.begin(), out.end());
+	return out;
+}
+
+template<typename Tscene>
+void TestPlayback() {
+	Tscene scene;
+	cs381::Entity a = scene.CreateEntity(), b = scene.CreateEntity(), c = scene.CreateEntity(), stale = scene.CreateEntity();
+	for(cs381::Entity e: {a, b, c})
+		scene.template AddComponent<Position>(e) = {1};
+	CHECK(ChangedPositions(scene).size() == 3);								// the first run sees every addition, later runs only what changed since
+	CHECK(ChangedPositions(scene).empty());
+
+	cs381::CommandBuffer<Tscene> buffer;
+	auto created = buffer.CreateEntity();
+	buffer.template AddComponent<Position>(created, {7});
+	buffer.template AddComponent<Velocity>(created);
+	buffer.template SetComponent<Position>(a, {42});
+	buffer.template RemoveComponent<Position>(b);
+	buffer.template SetComponent<Position>(b, {5});							// recorded after the removal, so b has nothing to set by then
+	buffer.template SetComponent<Velocity>(c, {3});							// c has no Velocity
+	buffer.DestroyEntity(c);
+	buffer.template AddComponent<Position>(stale, {9});
+	scene.DestroyEntity(stale);												// before playback, so the command is dropped
+	CHECK(!buffer.empty() && scene.template GetComponent<Position>(a).x == 1);	// nothing happens until playback
+
+	auto handles = buffer.Playback(scene);
+	CHECK(buffer.empty() && handles.size() == 1);
+	cs381::Entity e = handles[0];
+	CHECK(scene.IsAlive(e) && scene.template GetComponent<Position>(e).x == 7 && scene.template GetComponent<Velocity>(e).x == 0);
+	CHECK(scene.template GetComponent<Position>(a).x == 42);
+	CHECK(scene.IsAlive(b) && !scene.template HasComponent<Position>(b));
+	CHECK(!scene.IsAlive(c) && !scene.IsAlive(stale));
+	if(cs381::EntityIndex(e) == cs381::EntityIndex(stale))					// the new entity took the stale handle's slot, which must not have picked up its Position
+		CHECK(scene.template GetComponent<Position>(e).x == 7);
+
+	// deferred writes reach change driven systems: a was set, e was added
+	auto changed = ChangedPositions(scene);
+	std::vector<cs381::Entity> expected = {a, e};
+	std::sort(expected.begin(), expected.end());
+	CHECK(changed == expected);
+	CHECK(ChangedPositions(scene).empty());
+
+	// several buffers play back in one batch, each one's pending entities resolving to its own handles
+	cs381::CommandBuffer<Tscene> first, second;
+	auto one = first.CreateEntity();
+	first.template AddComponent<Position>(one, {1});
+	auto two = second.CreateEntity();
+	second.template AddComponent<Position>(two, {2});
+	second.template SetComponent<Position>(a, {43});
+	cs381::CommandBuffer<Tscene>* buffers[] = {&first, &second};
+	auto batches = cs381::CommandBuffer<Tscene>::Playback(scene, buffers);
+	CHECK(scene.template GetComponent<Position>(batches[0][0]).x == 1 && scene.template GetComponent<Position>(batches[1][0]).x == 2);
+	CHECK(ChangedPositions(scene).size() == 3);
+}
+
+int main() {
+	TestPlayback<cs381::Scene<cs381::ComponentStorage>>();
+	TestPlayback<cs381::Scene<cs381::SparseSetComponentStorage>>();
+	TestPlayback<cs381::Scene<cs381::CowComponentStorage>>();
+	TestPlayback<cs381::Scene<cs381::ArchetypeStorage>>();
+	return 0;
+}
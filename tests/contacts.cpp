@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "collision.hpp"
+#include "check.hpp"
+
+bool Near(float a, float b) { return std::abs(a - b) < 1e-5f; }
+
+void CheckOverlap(const cs381::OrientedBox& a, const cs381::OrientedBox& b, float normalX, float normalZ, float depth) {
+	float nx = 0, nz = 0, d = 0;
+	CHECK(cs381::BoxesOverlap(a, b, nx, nz, d));
+	CHECK(Near(nx, normalX) && Near(nz, normalZ) && Near(d, depth));
+	CHECK(cs381::BoxesOverlap(b, a, nx, nz, d));								// seen from b the normal flips, the depth stays
+	CHECK(Near(nx, -normalX) && Near(nz, -normalZ) && Near(d, depth));
+}
+
+void TestBoxesOverlap() {
+	cs381::OrientedBox a = {0, 0, 1, 0, 2, 1};								// 4 long along x, 2 wide along z
+	CheckOverlap(a, {3, 0, 1, 0, 2, 1}, 1, 0, 1);							// ends overlap by 1
+	CheckOverlap(a, {-3.5f, 0.2f, 1, 0, 2, 1}, -1, 0, 0.5f);
+	CheckOverlap(a, {0.5f, 1.5f, 1, 0, 2, 1}, 0, 1, 0.5f);					// side by side, shallowest along z
+	CheckOverlap(a, {2.5f, 0, 0, 1, 2, 1}, 1, 0, 0.5f);						// b turned 90 degrees, its width faces a's end
+
+	float nx, nz, depth;
+	CHECK(!cs381::BoxesOverlap(a, {4.5f, 0, 1, 0, 2, 1}, nx, nz, depth));
+	CHECK(!cs381::BoxesOverlap(a, {0, 2.5f, 1, 0, 2, 1}, nx, nz, depth));
+	float s = std::sqrt(0.5f);												// b at 45 degrees past a's corner: the boxes' bounds overlap, the boxes don't
+	CHECK(!cs381::BoxesOverlap(a, {3.3f, 2.3f, s, s, 1, 1}, nx, nz, depth));
+}
+
+void TestHeadOnExchange() {
+	cs381::ContactSettings settings;
+	settings.restitution = 1;												// elastic, equal masses swap velocities
+	settings.iterations = 4;
+	for(auto [va, vb]: {std::pair{5.0f, -5.0f}, std::pair{4.0f, 0.0f}}) {
+		std::vector<cs381::ContactBody> bodies = {{va, 0, 1}, {vb, 0, 1}};
+		std::vector<cs381::Contact> contacts = {{0, 1, 1, 0, 0.5f}};
+		cs381::SolveContacts(contacts, bodies, settings);
+		CHECK(Near(bodies[0].velocityX, vb) && Near(bodies[1].velocityX, va));
+		CHECK(bodies[0].velocityZ == 0 && bodies[1].velocityZ == 0);
+		CHECK(Near(bodies[0].velocityX + bodies[1].velocityX, va + vb));		// momentum is kept
+		float push = (0.5f - settings.slop) * settings.correction / 2;		// the penetration is undone half by each body
+		CHECK(Near(bodies[0].correctionX, -push) && Near(bodies[1].correctionX, push));
+	}
+
+	// a body nothing can push takes the whole impulse back
+	std::vector<cs381::ContactBody> bodies = {{4, 0, 1}, {0, 0, 0}};
+	std::vector<cs381::Contact> contacts = {{0, 1, 1, 0, 0.1f}};
+	cs381::ContactSettings settings2;
+	settings2.restitution = 1;
+	cs381::SolveContacts(contacts, bodies, settings2);
+	CHECK(Near(bodies[0].velocityX, -4) && bodies[1].velocityX == 0);
+}
+
+// island of every body (through its contacts) after Build, checking the islands are contiguous and share no body
+std::vector<int> CheckIslands(const cs381::ContactIslands& islands, const std::vector<cs381::Contact>& sorted, size_t bodyCount) {
+	CHECK(islands.start.front() == 0 && islands.start.back() == sorted.size());
+	std::vector<int> islandOf(bodyCount, -1);
+	for(size_t island = 0; island < islands.Count(); island++) {
+		CHECK(islands.start[island] < islands.start[island + 1]);			// no empty islands
+		for(size_t i = islands.start[island]; i < islands.start[island + 1]; i++)
+			for(uint32_t body: {sorted[i].a, sorted[i].b}) {
+				CHECK(islandOf[body] == -1 || islandOf[body] == int(island));
+				islandOf[body] = island;
+			}
+	}
+	return islandOf;
+}
+
+void TestIslands() {
+	// bodies 3, 4 and 5 form the first island, 0, 1 and 2 the second, 6 and 7 the third; depth tags each contact with its position in the input
+	std::vector<cs381::Contact> contacts = {{4, 5, 1, 0, 0}, {0, 1, 1, 0, 1}, {6, 7, 1, 0, 2}, {2, 1, 1, 0, 3}, {5, 3, 1, 0, 4}};
+	cs381::ContactIslands islands;
+	islands.Build(contacts, 8);
+	CHECK(islands.Count() == 3);
+	CHECK((islands.start == std::vector<uint32_t>{0, 2, 4, 5}));
+	std::vector<float> order;
+	for(auto& contact: contacts)
+		order.push_back(contact.depth);
+	CHECK((order == std::vector<float>{0, 4, 1, 3, 2}));					// islands in order of their first contact, contacts in input order within each
+	CheckIslands(islands, contacts, 8);
+
+	// random contact graphs: every contact lands in its bodies' island, islands keep input order, and building twice gives the same layout
+	std::mt19937 random(25);
+	for(int round = 0; round < 50; round++) {
+		size_t bodyCount = 200;
+		std::uniform_int_distribution<uint32_t> body(0, bodyCount - 1);
+		std::vector<cs381::Contact> input;
+		for(int i = 0; i < 150; i++) {
+			uint32_t a = body(random), b = body(random);
+			if(a != b) input.push_back({a, b, 1, 0, float(input.size())});
+		}
+		auto sorted = input;
+		islands.Build(sorted, bodyCount);
+		CHECK(sorted.size() == input.size());
+		auto islandOf = CheckIslands(islands, sorted, bodyCount);
+		for(size_t island = 0; island < islands.Count(); island++) {
+			for(size_t i = islands.start[island] + 1; i < islands.start[island + 1]; i++)
+				CHECK(sorted[i - 1].depth < sorted[i].depth);
+			if(island > 0)
+				CHECK(sorted[islands.start[island - 1]].depth < sorted[islands.start[island]].depth);
+		}
+		for(auto& contact: input)													// bodies sharing a contact share an island
+			CHECK(islandOf[contact.a] == islandOf[contact.b]);
+
+		auto again = input;
+		cs381::ContactIslands rebuilt;
+		rebuilt.Build(again, bodyCount);
+		CHECK(rebuilt.start == islands.start);
+		for(size_t i = 0; i < again.size(); i++)
+			CHECK(again[i].depth == sorted[i].depth);
+	}
+}
+
+int main() {
+	TestBoxesOverlap();
+	TestHeadOnExchange();
+	TestIslands();
+	return 0;
+}
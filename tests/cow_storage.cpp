@@ -0,0 +1,50 @@
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x, y, z, w; };
+struct Velocity { float x, y, z, w; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Velocity> {};
+
+using Scene = cs381::Scene<cs381::CowComponentStorage>;
+
+int main() {
+	Scene scene;
+	constexpr size_t PerPage = cs381::CowComponentStorage::PageBytes / sizeof(Position);
+	constexpr size_t Pages = 8;
+	auto entities = scene.Spawn<Position, Velocity>(PerPage * Pages, [](size_t i, cs381::Entity, Position& position, Velocity& velocity) {
+		position = {float(i), 0, 0, 0};
+		velocity = {1, 0, 0, 0};
+	});
+	auto& positions = scene.storages[cs381::GetComponentID<Position>()];
+	auto& velocities = scene.storages[cs381::GetComponentID<Velocity>()];
+	CHECK(positions.pages.size() == Pages && positions.SharedPages() == 0);
+
+	Scene fork = scene.Fork();
+	auto& forkPositions = fork.storages[cs381::GetComponentID<Position>()];
+	CHECK(forkPositions.SharedPages() == Pages && positions.SharedPages() == Pages);
+
+	// reads through the const accessors leave every page shared
+	const Scene& constFork = fork;
+	float sum = 0;
+	for(cs381::Entity e: entities)
+		sum += constFork.GetComponent<Position>(e).x;
+	fork.ForEach<const Position, const Velocity>([&](cs381::Entity, const Position& position, const Velocity& velocity) { sum += position.x * velocity.x; });
+	CHECK(sum > 0);
+	CHECK(forkPositions.SharedPages() == Pages && velocities.SharedPages() == Pages);
+
+	// a few writes copy only the pages they land on, in the fork only
+	fork.GetComponent<Position>(entities[0]).x = -1;
+	fork.GetComponent<Position>(entities[1]).x = -2;						// same page as the first write
+	fork.GetComponent<Position>(entities[3 * PerPage + 5]).x = -3;
+	CHECK(forkPositions.SharedPages() == Pages - 2 && positions.SharedPages() == Pages - 2);
+	CHECK(fork.storages[cs381::GetComponentID<Velocity>()].SharedPages() == Pages);
+	CHECK(scene.GetComponent<Position>(entities[0]).x == 0 && scene.GetComponent<Position>(entities[3 * PerPage + 5]).x == float(3 * PerPage + 5));
+	CHECK(constFork.GetComponent<Position>(entities[1]).x == -2 && constFork.GetComponent<Position>(entities[2]).x == 2);
+
+	// ForEach with a mutable component copies what it hands out, the const one beside it still doesn't
+	fork.ForEach<Position, const Velocity>([&](cs381::Entity, Position& position, const Velocity& velocity) { position.x += velocity.x; });
+	CHECK(forkPositions.SharedPages() == 0 && fork.storages[cs381::GetComponentID<Velocity>()].SharedPages() == Pages);
+	CHECK(scene.GetComponent<Position>(entities[7]).x == 7 && fork.GetComponent<Position>(entities[7]).x == 8);
+	return 0;
+}
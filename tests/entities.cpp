@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <vector>
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Health { int points = 100; };
+struct Poisoned {};
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Health, Poisoned> {};
+
+using Scene = cs381::Scene<cs381::ComponentStorage>;
+
+int main() {
+	Scene scene;
+	cs381::Entity a = scene.CreateEntity(), b = scene.CreateEntity(), c = scene.CreateEntity();
+	CHECK(cs381::EntityIndex(a) == 0 && cs381::EntityIndex(c) == 2 && cs381::EntityGeneration(a) == 0);
+	CHECK(scene.IsAlive(a) && scene.IsAlive(b) && scene.IsAlive(c) && !scene.IsAlive(cs381::InvalidEntity));
+	scene.AddComponent<Health>(b).points = 5;
+	scene.AddComponent<Poisoned>(b);
+
+	// destroying frees the slot, and the next entity created takes it with a new generation
+	scene.DestroyEntity(b);
+	CHECK(!scene.IsAlive(b) && !scene.HasComponent<Health>(b) && scene.GetEntity(cs381::EntityIndex(b)) == cs381::InvalidEntity);
+	cs381::Entity d = scene.CreateEntity();
+	CHECK(cs381::EntityIndex(d) == cs381::EntityIndex(b) && cs381::EntityGeneration(d) == 1 && d != b);
+	CHECK(scene.IsAlive(d) && !scene.IsAlive(b) && scene.GetEntity(cs381::EntityIndex(d)) == d && scene.entityMasks.size() == 3);
+
+	// the flat storage keeps the old component's bytes, but the new owner starts without it and gets a fresh one when it is added
+	CHECK(!scene.HasComponent<Health>(d) && !scene.HasComponent<Poisoned>(d));
+	CHECK(scene.AddComponent<Health>(d).points == 100);
+
+	// stale handles are ignored, they can't reach the entity now living in their slot
+	scene.DestroyEntity(b);
+	scene.RemoveComponent<Health>(b);
+	CHECK(scene.IsAlive(d) && scene.HasComponent<Health>(d));
+
+	// slots are reused last destroyed first, before the scene grows
+	scene.DestroyEntity(a);
+	scene.DestroyEntity(c);
+	CHECK(scene.entities.freeList.size() == 2);
+	cs381::Entity e = scene.CreateEntity(), f = scene.CreateEntity(), g = scene.CreateEntity();
+	CHECK(cs381::EntityIndex(e) == cs381::EntityIndex(c) && cs381::EntityIndex(f) == cs381::EntityIndex(a) && cs381::EntityIndex(g) == 3);
+	CHECK(!scene.IsAlive(a) && !scene.IsAlive(c) && scene.entities.freeList.empty());
+
+	// Spawn takes free slots first too, then grows the scene once for the rest
+	for(cs381::Entity entity: {e, f, d})
+		scene.DestroyEntity(entity);
+	auto spawned = scene.Spawn<Health>(5, [](size_t i, cs381::Entity, Health& health) { health.points = int(i); });
+	std::vector<size_t> slots;
+	for(cs381::Entity entity: spawned)
+		slots.push_back(cs381::EntityIndex(entity));
+	CHECK((slots == std::vector<size_t>{1, 0, 2, 4, 5}) && scene.entityMasks.size() == 6);
+	CHECK(cs381::EntityGeneration(spawned[0]) == 2 && cs381::EntityGeneration(spawned[3]) == 0);
+	for(size_t i = 0; i < spawned.size(); i++)
+		CHECK(scene.IsAlive(spawned[i]) && scene.GetComponent<Health>(spawned[i]).points == int(i) && !scene.HasComponent<Poisoned>(spawned[i]));
+	CHECK(!scene.IsAlive(d) && !scene.IsAlive(e) && scene.IsAlive(g));
+
+	size_t healthy = 0;
+	scene.ForEach<Health>([&](cs381::Entity, Health&) { healthy++; });
+	CHECK(healthy == spawned.size());
+	return 0;
+}
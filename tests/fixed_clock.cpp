@@ -0,0 +1,31 @@
+#include <cmath>
+#include "clock.hpp"
+#include "check.hpp"
+
+int main() {
+	cs381::FixedClock clock(100);
+	CHECK(clock.Step() == 0.01f && clock.Advance(0) == 0 && clock.Alpha() == 0);
+
+	// time is spent in whole ticks, the rest carries over to the next frame and sets Alpha
+	CHECK(clock.Advance(0.025) == 2 && std::abs(clock.Alpha() - 0.5f) < 1e-4f);
+	CHECK(clock.Advance(0.004) == 0 && std::abs(clock.Alpha() - 0.9f) < 1e-4f);
+	CHECK(clock.Advance(0.002) == 1 && std::abs(clock.Alpha() - 0.1f) < 1e-4f && clock.ticks == 3);
+	CHECK(clock.Advance(-1) == 0 && clock.ticks == 3);						// a clock going backwards adds nothing
+
+	// the same span of time runs the same ticks at any frame rate
+	for(double fps: {30.0, 60.0, 144.0, 1000.0}) {
+		cs381::FixedClock framed(120);
+		size_t steps = 0;
+		for(int frame = 0; frame < int(fps * 10); frame++)
+			steps += framed.Advance(1 / fps);
+		CHECK(steps == framed.ticks && (steps == 1200 || steps == 1199));	// the last tick may be a rounding error short
+		CHECK(std::abs(framed.Time() + framed.accumulator - 10) < 1e-9 && framed.dropped == 0);
+		CHECK(framed.Alpha() >= 0 && framed.Alpha() <= 1);
+	}
+
+	// a hitch runs at most maxSteps ticks, the time past them is dropped rather than caught up over the next frames
+	cs381::FixedClock hitched(100, 8);
+	CHECK(hitched.Advance(0.5) == 8 && std::abs(hitched.dropped - 0.42) < 1e-9 && hitched.accumulator < hitched.step);
+	CHECK(hitched.Advance(0.01) == 1 && std::abs(hitched.Time() - 0.09) < 1e-9);
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include <vector>
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x, y, z, w; };
+struct Velocity { float x, y, z, w; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Velocity> {};
+
+constexpr size_t TicksPerPage = cs381::CowComponentStorage::PageBytes / sizeof(cs381::ChangeTracker::Stamp);
+
+// bytes a fork holds for itself: everything but the pages it shares with the scene it came from
+size_t CopiedBytes(const cs381::SceneStats& stats) {
+	size_t shared = stats.changeSharedBytes;
+	for(auto& component: stats.components)
+		shared += component.sharedBytes;
+	return stats.TotalBytes() - shared;
+}
+
+template<typename Tscene>
+size_t CountChanged(Tscene& scene) {
+	size_t count = 0;
+	scene.template GetQuery<Position>().template ForEach<cs381::Changed<Position>>([&](cs381::Entity, Position&) { count++; });
+	return count;
+}
+
+template<typename Tscene>
+void TestFork(bool sharedComponents) {
+	Tscene scene;
+	constexpr size_t Pages = 8;
+	auto entities = scene.template Spawn<Position, Velocity>(TicksPerPage * Pages, [](size_t i, cs381::Entity, Position& position, Velocity& velocity) {
+		position = {float(i), 0, 0, 0};
+		velocity = {1, 0, 0, 0};
+	});
+	CHECK(CountChanged(scene) == entities.size());							// registers the query and records its run
+
+	// the fork shares every tick page; per slot it copies a mask, a generation and the query's entity and position lists, not 8 bytes of ticks per component
+	Tscene fork = scene.Fork();
+	auto before = scene.Stats(), forked = fork.Stats();
+	CHECK(forked.changeSharedBytes == 2 * Pages * cs381::CowComponentStorage::PageBytes && before.changeSharedBytes == forked.changeSharedBytes);
+	size_t perSlot = sizeof(cs381::Signature) + sizeof(cs381::Entity) + sizeof(cs381::Entity) + sizeof(uint32_t);
+	CHECK(forked.maskBytes + forked.entityBytes + forked.queryBytes <= entities.size() * perSlot + 1024);
+	CHECK(forked.changeBytes - forked.changeSharedBytes < 1024);				// the page tables
+	if(sharedComponents) CHECK(CopiedBytes(forked) <= entities.size() * perSlot + 4096);
+
+	// stamping copies only the tick pages written to, and only the fork sees its writes as changes
+	fork.template GetMutable<Position>(entities[0]).x = -1;
+	fork.template GetMutable<Position>(entities[1]).x = -2;					// same page as the first write
+	fork.template GetMutable<Position>(entities[5 * TicksPerPage]).x = -3;
+	forked = fork.Stats();
+	CHECK(forked.changeSharedBytes == (2 * Pages - 2) * cs381::CowComponentStorage::PageBytes && scene.Stats().changeSharedBytes == forked.changeSharedBytes);
+	CHECK(CountChanged(fork) == 3 && CountChanged(scene) == 0);
+	CHECK(scene.template GetComponent<Position>(entities[0]).x == 0 && fork.template GetComponent<Position>(entities[0]).x == -1);
+
+	// an entity added to the fork after it split off stamps fresh pages of its own
+	cs381::Entity added = fork.CreateEntity();
+	fork.template AddComponent<Position>(added);
+	CHECK(CountChanged(fork) == 1 && CountChanged(scene) == 0 && !scene.IsAlive(added));
+}
+
+int main() {
+	TestFork<cs381::Scene<cs381::ComponentStorage>>(false);
+	TestFork<cs381::Scene<cs381::CowComponentStorage>>(true);
+	TestFork<cs381::Scene<cs381::ArchetypeStorage>>(false);
+	return 0;
+}
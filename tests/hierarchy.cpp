@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <vector>
+#include "hierarchy.hpp"
+#include "check.hpp"
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<TransformComponent, PreviousTransformComponent, ParentComponent, ChildrenComponent, WorldTransformComponent> {};
+
+using Scene = cs381::Scene<cs381::ComponentStorage>;
+
+cs381::Entity Spawn(Scene& scene, raylib::Vector3 position)
+{
+    cs381::Entity e = scene.CreateEntity();
+    scene.AddComponent<TransformComponent>(e).position = position;
+    scene.AddComponent<WorldTransformComponent>(e);
+    return e;
+}
+
+raylib::Vector3 WorldPosition(Scene& scene, cs381::Entity e)
+{
+    auto& matrix = scene.GetComponent<WorldTransformComponent>(e).matrix;
+    return {matrix.m12, matrix.m13, matrix.m14};
+}
+
+bool Near(raylib::Vector3 a, raylib::Vector3 b)
+{
+    return a.Distance(b) < 1e-5f;
+}
+
+// entities whose world matrix Propagate recomputed since the last call
+std::vector<cs381::Entity> Recomputed(Scene& scene)
+{
+    std::vector<cs381::Entity> out;
+    scene.GetQuery<WorldTransformComponent>().ForEach<cs381::Changed<WorldTransformComponent>>([&](cs381::Entity e, WorldTransformComponent&) { out.push_back(e); });
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+bool ParentsFirst(const TransformHierarchy& hierarchy)
+{
+    for (uint32_t i = 0; i < hierarchy.order.size(); i++)
+    {
+        if (hierarchy.order[i].parent != TransformHierarchy::Root && hierarchy.order[i].parent >= i) return false;
+    }
+    return true;
+}
+
+int main()
+{
+    Scene scene;
+    TransformHierarchy hierarchy;
+
+    // children are created before their parents, so slot order alone would put them first
+    cs381::Entity grandchild = Spawn(scene, {0, 0, 1});
+    cs381::Entity left = Spawn(scene, {1, 0, 0});
+    cs381::Entity right = Spawn(scene, {-1, 0, 0});
+    cs381::Entity root = Spawn(scene, {10, 0, 0});
+    hierarchy.SetParent(scene, grandchild, left);
+    hierarchy.SetParent(scene, left, root);
+    hierarchy.SetParent(scene, right, root);
+    scene.GetComponent<TransformComponent>(root).heading = 90;
+
+    hierarchy.Propagate(scene);
+    CHECK(hierarchy.order.size() == 4 && hierarchy.order[0].entity == root && ParentsFirst(hierarchy));
+    CHECK((Recomputed(scene) == std::vector<cs381::Entity>{grandchild, left, right, root}));
+    CHECK(Near(WorldPosition(scene, root), {10, 0, 0}));
+    CHECK(Near(WorldPosition(scene, left), {10, 0, -1}));                 // turned 90 degrees with the root
+    CHECK(Near(WorldPosition(scene, right), {10, 0, 1}));
+    CHECK(Near(WorldPosition(scene, grandchild), {11, 0, -1}));
+
+    // nothing changed, nothing is recomputed
+    hierarchy.Propagate(scene);
+    CHECK(Recomputed(scene).empty());
+
+    // a change recomputes the entity and its subtree, its siblings and their subtrees are skipped
+    scene.GetMutable<TransformComponent>(right).position.y = 2;
+    hierarchy.Propagate(scene);
+    CHECK((Recomputed(scene) == std::vector<cs381::Entity>{right}) && Near(WorldPosition(scene, right), {10, 2, 1}));
+    scene.GetMutable<TransformComponent>(left).position.x = 2;
+    hierarchy.Propagate(scene);
+    CHECK((Recomputed(scene) == std::vector<cs381::Entity>{grandchild, left}) && Near(WorldPosition(scene, grandchild), {11, 0, -2}));
+    scene.GetMutable<TransformComponent>(root).heading = 0;
+    hierarchy.Propagate(scene);
+    CHECK(Recomputed(scene).size() == 4 && Near(WorldPosition(scene, grandchild), {12, 0, 1}));
+
+    // entities joining without SetParent are picked up as roots on the next pass, which rebuilds order and recomputes everything
+    cs381::Entity joined = Spawn(scene, {0, 5, 0});
+    hierarchy.Propagate(scene);
+    CHECK(hierarchy.order.size() == 5 && ParentsFirst(hierarchy) && Near(WorldPosition(scene, joined), {0, 5, 0}) && Recomputed(scene).size() == 5);
+
+    // losing a component or being destroyed drops the entity, the destroyed parent's children become roots
+    scene.RemoveComponent<WorldTransformComponent>(joined);
+    hierarchy.Propagate(scene);
+    CHECK(hierarchy.order.size() == 4 && Recomputed(scene).size() == 4);
+    scene.DestroyEntity(left);
+    hierarchy.Propagate(scene);
+    CHECK(hierarchy.order.size() == 3 && ParentsFirst(hierarchy) && Near(WorldPosition(scene, grandchild), {0, 0, 1}) && Recomputed(scene).size() == 3);
+    hierarchy.Propagate(scene);
+    CHECK(Recomputed(scene).empty());
+
+    // entities with a previous transform are placed between it and the current one
+    scene.AddComponent<PreviousTransformComponent>(right) = {{-3, 2, 0}, 0};
+    hierarchy.Propagate(scene, 0.5f);
+    CHECK((Recomputed(scene) == std::vector<cs381::Entity>{right}) && Near(WorldPosition(scene, right), {8, 2, 0}));
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <random>
+#include <vector>
+#include "ECS.hpp"
+#include "check.hpp"
+
+// what MatchSignatures computes, one signature at a time
+uint64_t Expected(const cs381::Signature* signatures, size_t count, cs381::Signature required, cs381::Signature excluded) {
+	uint64_t out = 0;
+	for(size_t i = 0; i < count; i++)
+		if((signatures[i].bits & required.bits) == required.bits && (signatures[i].bits & excluded.bits) == 0)
+			out |= uint64_t(1) << i;
+	return out;
+}
+
+int main() {
+	std::mt19937_64 random(381);
+	// few components per signature, so that required sets of a couple of bits match often and every lane pattern comes up
+	auto signature = [&] { return cs381::Signature{random() & random() & random()}; };
+
+	std::vector<cs381::Signature> signatures(64 + 3);
+	for(int round = 0; round < 2000; round++) {
+		for(auto& s: signatures) s = signature();
+		cs381::Signature required{random() & random() & random() & random()};
+		cs381::Signature excluded{round % 2 ? random() & random() & random() & random() : 0};
+		size_t offset = round % 4;												// unaligned starts
+		for(size_t count = 0; count <= 64; count++)
+			CHECK(cs381::MatchSignatures(signatures.data() + offset, count, required, excluded) == Expected(signatures.data() + offset, count, required, excluded));
+	}
+
+	// the halves of a lane are tested together: a signature only matching required in its low or high word must not match
+	cs381::Signature split[4] = {{0x00000001'00000000}, {0x00000000'00000001}, {0x00000001'00000001}, {0x80000001'00000001}};
+	CHECK(cs381::MatchSignatures(split, 4, {0x00000001'00000001}) == 0b1100);
+	CHECK(cs381::MatchSignatures(split, 4, {0x00000001'00000001}, cs381::Signature::Alive()) == 0b0100);
+	CHECK(cs381::MatchSignatures(split, 4, {}) == 0b1111);
+	return 0;
+}
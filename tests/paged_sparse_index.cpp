@@ -0,0 +1,56 @@
+#include <utility>
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x, y; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position> {};
+
+using Index = cs381::PagedSparseIndex;
+
+int main() {
+	Index index;
+	CHECK(index.Get(0) == Index::npos && index.Get(1'000'000) == Index::npos && index.MemoryBytes() == 0);
+
+	// writing a slot allocates its page only, the pages before it share the empty one
+	index.Set(5 * Index::PageSize + 3, 7);
+	CHECK(index.pages.size() == 6 && index.AllocatedPages() == 1);
+	for(size_t page = 0; page < 5; page++)
+		CHECK(index.pages[page] == &Index::emptyPage);
+	CHECK(index.Get(5 * Index::PageSize + 3) == 7 && index.Get(5 * Index::PageSize + 2) == Index::npos && index.Get(3) == Index::npos);
+	index.Set(5 * Index::PageSize, 1);
+	index.Set(6 * Index::PageSize - 1, 2);
+	CHECK(index.AllocatedPages() == 1 && index.Get(5 * Index::PageSize) == 1 && index.Get(6 * Index::PageSize - 1) == 2);
+
+	// clearing a slot of a page that was never written leaves it unallocated, the empty page itself is never written
+	index.Set(2 * Index::PageSize, Index::npos);
+	index.Set(20 * Index::PageSize, Index::npos);
+	CHECK(index.AllocatedPages() == 1 && Index::emptyPage[0] == Index::npos);
+	index.Set(5 * Index::PageSize + 3, Index::npos);						// an allocated page just stores npos
+	CHECK(index.AllocatedPages() == 1 && index.Get(5 * Index::PageSize + 3) == Index::npos);
+	CHECK(index.MemoryBytes() == index.pages.capacity() * sizeof(const Index::Page*) + sizeof(Index::Page));
+
+	// copies own their pages, so writes to either side stay on that side
+	Index copy = index;
+	CHECK(copy.AllocatedPages() == 1 && copy.pages[5] != index.pages[5] && copy.pages[0] == &Index::emptyPage);
+	copy.Set(5 * Index::PageSize, 100);
+	copy.Set(Index::PageSize, 200);
+	CHECK(index.Get(5 * Index::PageSize) == 1 && index.Get(Index::PageSize) == Index::npos && index.AllocatedPages() == 1);
+	CHECK(copy.Get(5 * Index::PageSize) == 100 && copy.Get(Index::PageSize) == 200 && copy.AllocatedPages() == 2);
+	copy = index;
+	CHECK(copy.Get(5 * Index::PageSize) == 1 && copy.Get(Index::PageSize) == Index::npos && copy.AllocatedPages() == 1);
+
+	// moves hand the pages over without copying them
+	const Index::Page* page = index.pages[5];
+	Index moved = std::move(index);
+	CHECK(moved.pages[5] == page && index.pages.empty() && index.Get(5 * Index::PageSize) == Index::npos);
+	copy = std::move(moved);
+	CHECK(copy.pages[5] == page && copy.Get(6 * Index::PageSize - 1) == 2);
+
+	// the sparse storages index far slots without allocating the pages below them
+	cs381::SparseSetComponentStorage storage(Position{});
+	storage.GetOrAllocate<Position>(40 * Index::PageSize) = {1, 2};
+	CHECK(storage.sparse.AllocatedPages() == 1 && storage.Get<Position>(40 * Index::PageSize).y == 2);
+	CHECK(storage.Memory().indexBytes < 2 * sizeof(Index::Page));
+	return 0;
+}
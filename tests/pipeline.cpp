@@ -0,0 +1,60 @@
+#include "pipeline.hpp"
+#include "check.hpp"
+
+struct Position { float x; };
+struct Velocity { float x; };
+struct Leader { cs381::Entity entity; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Velocity, Leader> {};
+
+using Scene = cs381::Scene<cs381::ComponentStorage>;
+
+struct MoveKernel : cs381::Kernel<Position, const Velocity> {
+	void operator()(cs381::Entity, Position& position, const Velocity& velocity) const { position.x += velocity.x; }
+};
+
+struct DragKernel : cs381::Kernel<Velocity> {
+	void operator()(cs381::Entity, Velocity& velocity) const { velocity.x *= 0.5f; }
+};
+
+// followers stay one unit ahead of their leader, reading its position (which MoveKernel writes) through the scene
+struct FollowKernel : cs381::Kernel<Position, const Leader> {
+	using CrossReads = std::tuple<Position>;
+	Scene* scene;
+
+	void operator()(cs381::Entity, Position& position, const Leader& leader) const { position.x = scene->GetComponent<Position>(leader.entity).x + 1; }
+};
+
+using Following = cs381::Pipeline<MoveKernel, FollowKernel>;
+static_assert(Following::Breaks<cs381::Fusion::Checked>() == std::array{false, true}, "FollowKernel reads what MoveKernel writes, so it needs a pass of its own");
+static_assert(Following::Breaks<cs381::Fusion::Generic>() == std::array{false, false});
+// cross reads are only read, so listing them const means the same
+struct ConstFollowKernel : FollowKernel {
+	using CrossReads = std::tuple<const Position>;
+};
+static_assert(cs381::KernelTraits<ConstFollowKernel>::crossReads == cs381::KernelTraits<FollowKernel>::crossReads);
+static_assert(cs381::Pipeline<MoveKernel, ConstFollowKernel>::Breaks<cs381::Fusion::Checked>() == std::array{false, true});
+static_assert(cs381::Pipeline<MoveKernel, DragKernel>::Breaks<cs381::Fusion::Checked>() == std::array{false, false}, "kernels without cross reads always fuse");
+
+// the follower sits in a lower slot than its leader, so a fused loop reaches it before its leader has moved
+float FollowerAfterOneTick(bool checked) {
+	Scene scene;
+	cs381::Entity follower = scene.CreateEntity();
+	cs381::Entity leader = scene.CreateEntity();
+	scene.AddComponent<Position>(leader) = {0};
+	scene.AddComponent<Velocity>(leader) = {1};
+	scene.AddComponent<Position>(follower) = {0};
+	scene.AddComponent<Leader>(follower) = {leader};
+
+	cs381::Pipeline pipeline(MoveKernel{}, FollowKernel{{}, &scene});
+	if(checked) pipeline.Run<cs381::Fusion::Checked>(scene);
+	else pipeline.Run<cs381::Fusion::Generic>(scene);
+	CHECK(scene.GetComponent<Position>(leader).x == 1);
+	return scene.GetComponent<Position>(follower).x;
+}
+
+int main() {
+	CHECK(FollowerAfterOneTick(true) == 2);									// split: every leader moves before any follower looks
+	CHECK(FollowerAfterOneTick(false) == 1);								// fused: the follower saw its leader's old position
+	return 0;
+}
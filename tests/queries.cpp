@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x; };
+struct Velocity { float x; };
+struct Player {};
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Velocity, Player> {};
+
+using Scene = cs381::Scene<cs381::ComponentStorage>;
+
+// the entities a query lists, sorted, against the ones a full scan finds
+template<typename... Tcomponents>
+void CheckQuery(Scene& scene, Scene::Query<Tcomponents...> query) {
+	std::vector<cs381::Entity> listed(query.begin(), query.end()), scanned;
+	scene.ForEach<Tcomponents...>([&](cs381::Entity e, Tcomponents&...) { scanned.push_back(e); });
+	std::sort(listed.begin(), listed.end());
+	std::sort(scanned.begin(), scanned.end());
+	CHECK(listed == scanned && query.size() == scanned.size());
+	for(size_t i = 0; i < query.cache->entities.size(); i++)
+		CHECK(query.cache->positions[cs381::EntityIndex(query.cache->entities[i])] == i);
+}
+
+int main() {
+	Scene scene;
+	auto moving = scene.GetQuery<Position, Velocity>();						// registered before any entity exists, kept up to date from then on
+	auto players = scene.GetQuery<Player>();
+	CHECK(moving.size() == 0 && (scene.GetQuery<Velocity, Position>().cache == moving.cache));	// one cache per signature, whatever the order
+
+	std::mt19937 random(4);
+	std::vector<cs381::Entity> entities;
+	for(int step = 0; step < 5000; step++) {
+		size_t pick = entities.empty() ? 0 : random() % entities.size();
+		switch(random() % 8) {
+		case 0: case 1: entities.push_back(scene.CreateEntity()); break;
+		case 2: if(!entities.empty()) scene.AddComponent<Position>(entities[pick]).x = float(step); break;
+		case 3: if(!entities.empty()) scene.AddComponent<Velocity>(entities[pick]); break;
+		case 4: if(!entities.empty()) scene.AddComponent<Player>(entities[pick]); break;
+		case 5: if(!entities.empty()) scene.RemoveComponent<Velocity>(entities[pick]); break;
+		case 6: if(!entities.empty()) scene.RemoveComponent<Position>(entities[pick]); break;
+		case 7:
+			if(entities.empty()) break;
+			scene.DestroyEntity(entities[pick]);
+			scene.RemoveComponent<Position>(entities[pick]);					// stale now, ignored
+			entities[pick] = entities.back();
+			entities.pop_back();
+			break;
+		}
+		if(step % 500 == 0) {
+			auto spawned = scene.Spawn<Position, Velocity>(20, [](size_t, cs381::Entity, Position&, Velocity&) {});
+			entities.insert(entities.end(), spawned.begin(), spawned.end());
+		}
+		if(step % 50 == 0) {
+			CheckQuery(scene, moving);
+			CheckQuery(scene, players);
+		}
+	}
+	CheckQuery(scene, moving);
+	CHECK(moving.size() > 0 && players.size() > 0);
+
+	// a query registered late starts from a full scan and then agrees with the early one
+	auto positions = scene.GetQuery<Position>();
+	CheckQuery(scene, positions);
+	for(size_t i = 0; i < entities.size(); i += 7)
+		scene.RemoveComponent<Position>(entities[i]);
+	CheckQuery(scene, positions);
+	CheckQuery(scene, moving);
+
+	// ForEach visits what it lists and stops when fn returns false
+	size_t visited = 0;
+	moving.ForEach([&](cs381::Entity e, Position&, Velocity&) {
+		CHECK(scene.HasComponent<Position>(e) && scene.HasComponent<Velocity>(e));
+		return ++visited < 3;
+	});
+	CHECK(visited == 3);
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "simd.hpp"
+#include "check.hpp"
+
+int main() {
+	// angles over the whole reduced range plus the quadrant edges, and a few past the limit that fall back to std::sin/std::cos
+	std::vector<float> radians;
+	std::mt19937 random(381);
+	std::uniform_real_distribution<float> angle(-cs381::detail::SinCosLimit, cs381::detail::SinCosLimit), small(-10, 10);
+	for(int i = 0; i < 100000; i++)
+		radians.push_back(i % 2 ? angle(random) : small(random));
+	for(int quadrant = -64; quadrant <= 64; quadrant++)
+		for(float offset: {-1e-6f, 0.0f, 1e-6f})
+			radians.push_back(quadrant * float(M_PI / 4) + offset);
+	for(float outside: {-1e5f, 9000.0f, 1e7f})
+		radians.push_back(outside);
+	size_t count = radians.size();											// not a multiple of 8, so every variant runs its scalar tail too
+
+	std::vector<float> sines(count), cosines(count);
+	cs381::SinCos(radians.data(), sines.data(), cosines.data(), count);
+	double worst = 0;
+	for(size_t i = 0; i < count; i++) {
+		worst = std::max(worst, std::abs(sines[i] - std::sin(double(radians[i]))));
+		worst = std::max(worst, std::abs(cosines[i] - std::cos(double(radians[i]))));
+	}
+	CHECK(worst < 1.2e-7);
+
+	// every variant gives the same bits, so replays match whichever one a machine picks
+	auto same = [&](cs381::detail::SinCosFunction variant) {
+		std::vector<float> s(count), c(count);
+		variant(radians.data(), s.data(), c.data(), count);
+		return std::memcmp(s.data(), sines.data(), count * sizeof(float)) == 0 && std::memcmp(c.data(), cosines.data(), count * sizeof(float)) == 0;
+	};
+	CHECK(same(cs381::detail::SinCosScalar));
+#ifdef CS381_SIMD_X86
+	CHECK(same(cs381::detail::SinCosSSE2));
+	if(__builtin_cpu_supports("avx2")) CHECK(same(cs381::detail::SinCosAVX2));
+#endif
+	return 0;
+}
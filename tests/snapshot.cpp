@@ -0,0 +1,95 @@
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "snapshot.hpp"
+#include "check.hpp"
+
+struct Position { float x, y; };
+struct Health { int points; };
+struct Marked {};
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Health, Marked> {};
+
+using Scene = cs381::Scene<cs381::ComponentStorage>;
+
+std::vector<char> ReadFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+void WriteFile(const std::string& path, const std::vector<char>& bytes) {
+	std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+}
+
+int main() {
+	std::string path = (std::filesystem::temp_directory_path() / "cs381_test.snapshot").string();
+	std::string corrupt = (std::filesystem::temp_directory_path() / "cs381_test_corrupt.snapshot").string();
+
+	Scene scene;
+	std::vector<cs381::Entity> entities;
+	for(int i = 0; i < 100; i++) {
+		entities.push_back(scene.CreateEntity());
+		scene.AddComponent<Position>(entities.back()) = {float(i), -float(i)};
+		if(i % 2) scene.AddComponent<Health>(entities.back()).points = i;
+		if(i % 5 == 0) scene.AddComponent<Marked>(entities.back());
+	}
+	for(int i = 0; i < 100; i += 7)
+		scene.DestroyEntity(entities[i]);
+	CHECK(cs381::SaveSnapshot(scene, path));
+
+	// a round trip restores masks, components, generations and the free list, so the same slots are reused in the same order
+	Scene loaded;
+	auto marked = loaded.GetQuery<Position, Marked>();						// registered before the load, rebuilt by it
+	CHECK(cs381::LoadSnapshot(loaded, path));
+	CHECK(loaded.entityMasks.size() == scene.entityMasks.size() && loaded.entities.freeList == scene.entities.freeList);
+	for(int i = 0; i < 100; i++) {
+		CHECK(loaded.IsAlive(entities[i]) == (i % 7 != 0));
+		if(i % 7 == 0) continue;
+		CHECK(loaded.GetComponent<Position>(entities[i]).x == float(i) && loaded.GetComponent<Position>(entities[i]).y == -float(i));
+		CHECK(loaded.HasComponent<Health>(entities[i]) == bool(i % 2) && loaded.HasComponent<Marked>(entities[i]) == (i % 5 == 0));
+		if(i % 2) CHECK(loaded.GetComponent<Health>(entities[i]).points == i);
+	}
+	size_t count = 0;
+	marked.ForEach([&](cs381::Entity e, Position&, Marked&) { CHECK(cs381::EntityIndex(e) % 5 == 0 && cs381::EntityIndex(e) % 7 != 0); count++; });
+	CHECK(count == 20 - 3);
+	CHECK(scene.CreateEntity() == loaded.CreateEntity());
+
+	// every corruption below is caught when the file is opened, and a failed load leaves the scene as it was
+	std::vector<char> good = ReadFile(path);
+	cs381::SnapshotFile file(path);
+	CHECK(file.IsOpen());
+	auto header = file.Header();
+	file.Close();
+	auto rejects = [&](std::function<void(std::vector<char>&)> corruption) {
+		std::vector<char> bytes = good;
+		corruption(bytes);
+		WriteFile(corrupt, bytes);
+		Scene untouched;
+		cs381::Entity e = untouched.CreateEntity();
+		return !cs381::SnapshotFile(corrupt).IsOpen() && !cs381::LoadSnapshot(untouched, corrupt) && untouched.IsAlive(e) && untouched.entityMasks.size() == 1;
+	};
+	auto at = [&](std::vector<char>& bytes, uint64_t offset) -> char* { return bytes.data() + offset; };
+	uint64_t freeSlot = scene.entities.freeList.front();
+	uint64_t liveSlot = cs381::EntityIndex(entities[1]);
+
+	CHECK(!rejects([](std::vector<char>&) {}));
+	CHECK(rejects([](std::vector<char>& bytes) { bytes[0] = 'X'; }));				// bad magic
+	CHECK(rejects([](std::vector<char>& bytes) { bytes.resize(bytes.size() - 1); }));	// truncated
+	CHECK(rejects([](std::vector<char>& bytes) { bytes.resize(sizeof(cs381::SnapshotHeader) / 2); }));
+	CHECK(rejects([&](std::vector<char>& bytes) {										// a column running past the end of the file
+		((cs381::SnapshotColumn*)at(bytes, sizeof(cs381::SnapshotHeader)))->bytes = header.size;
+	}));
+	CHECK(rejects([&](std::vector<char>& bytes) {										// the last entity's Health past the end of its column
+		((cs381::SnapshotColumn*)at(bytes, sizeof(cs381::SnapshotHeader)))[cs381::GetComponentID<Health>()].bytes -= sizeof(Health);
+	}));
+	CHECK(rejects([&](std::vector<char>& bytes) { ((uint64_t*)at(bytes, header.freeList))[0] = header.slots; }));	// a free slot out of range
+	CHECK(rejects([&](std::vector<char>& bytes) { ((uint64_t*)at(bytes, header.freeList))[1] = freeSlot; }));		// the same slot listed twice
+	CHECK(rejects([&](std::vector<char>& bytes) { ((cs381::Entity*)at(bytes, header.generations))[liveSlot] |= cs381::EntityAllocator::FreeSlot; }));	// a live slot marked free
+	CHECK(rejects([&](std::vector<char>& bytes) { ((cs381::Signature*)at(bytes, header.masks))[freeSlot].set(cs381::Signature::AliveBit); }));		// a free slot marked alive
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(corrupt);
+	return 0;
+}
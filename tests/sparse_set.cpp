@@ -0,0 +1,73 @@
+#include <vector>
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x, y; };
+struct Selected {};
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Selected> {};
+
+using Scene = cs381::Scene<cs381::SparseSetComponentStorage>;
+
+// the dense arrays hold every component exactly once, and the sparse index points back at each one
+void CheckPacked(cs381::SparseSetComponentStorage& storage) {
+	CHECK(storage.dense.size() == storage.size() * sizeof(Position) && storage.Span<Position>().size() == storage.size());
+	for(size_t i = 0; i < storage.size(); i++)
+		CHECK(storage.sparse.Get(storage.Entities()[i]) == i);
+}
+
+int main() {
+	static_assert(cs381::RemovableStorage<cs381::SparseSetComponentStorage>);
+
+	Scene scene;
+	auto& storage = scene.GetStorage<Position>();
+	std::vector<cs381::Entity> entities;
+	for(int i = 0; i < 10; i++) {
+		entities.push_back(scene.CreateEntity());
+		if(i % 3 != 2) scene.AddComponent<Position>(entities.back()) = {float(i), 0};
+	}
+	CHECK(storage.size() == 7);												// only entities with the component take a slot
+	CheckPacked(storage);
+
+	// removing from the middle moves the last component into the hole
+	size_t last = storage.Entities().back();
+	size_t hole = storage.sparse.Get(cs381::EntityIndex(entities[1]));
+	scene.RemoveComponent<Position>(entities[1]);
+	CHECK(storage.size() == 6 && !storage.Contains(cs381::EntityIndex(entities[1])) && storage.Entities()[hole] == last);
+	CHECK(storage.At<Position>(hole).x == 9 && scene.GetComponent<Position>(entities[9]).x == 9);
+	CheckPacked(storage);
+
+	// destroying an entity releases its component as well, removing the last one needs no move
+	scene.DestroyEntity(entities[0]);
+	CHECK(storage.size() == 5 && !storage.Contains(cs381::EntityIndex(entities[0])));
+	cs381::Entity tail = scene.GetEntity(storage.Entities().back());
+	scene.RemoveComponent<Position>(tail);
+	CHECK(storage.size() == 4 && !storage.Contains(cs381::EntityIndex(tail)));
+	CheckPacked(storage);
+	float remaining = 0;
+	for(int i = 1; i < 10; i++)
+		if(scene.HasComponent<Position>(entities[i])) {
+			CHECK(scene.GetComponent<Position>(entities[i]).x == float(i));
+			remaining += float(i);
+		}
+
+	// a recycled slot starts without the component, adding it appends a fresh one
+	cs381::Entity reused = scene.CreateEntity();
+	CHECK(cs381::EntityIndex(reused) == cs381::EntityIndex(entities[0]) && !storage.Contains(cs381::EntityIndex(reused)));
+	scene.AddComponent<Position>(reused).y = 5;
+	CHECK(storage.size() == 5 && scene.GetComponent<Position>(reused).x == 0 && storage.Entities().back() == cs381::EntityIndex(reused));
+	CheckPacked(storage);
+
+	// tags never reach their storage
+	scene.AddComponent<Selected>(entities[3]);
+	CHECK(scene.HasComponent<Selected>(entities[3]) && scene.storages[cs381::GetComponentID<Selected>()].size() == 0);
+
+	// iteration walks the packed components; the dense span covers exactly the live ones
+	float sum = 0;
+	scene.ForEach<Position>([&](cs381::Entity, Position& position) { sum += position.x; });
+	float spanSum = 0;
+	for(auto& position: scene.Span<Position>()) spanSum += position.x;
+	CHECK(sum == remaining && spanSum == sum);
+	CHECK(scene.Stats().components[cs381::GetComponentID<Position>()].stored == 5);
+	return 0;
+}
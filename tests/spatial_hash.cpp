@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "spatial.hpp"
+#include "check.hpp"
+
+using Pairs = std::set<std::pair<cs381::Entity, cs381::Entity>>;
+
+struct Point { float x, z; };
+
+Pairs Normalized(const std::vector<cs381::SpatialHash::Pair>& pairs) {
+	Pairs out;
+	for(auto [a, b]: pairs) {
+		CHECK(a != b);
+		CHECK(out.insert(std::minmax(a, b)).second);							// each pair only once
+	}
+	return out;
+}
+
+Pairs BruteForcePairs(const std::vector<Point>& points, float distance) {
+	Pairs out;
+	for(size_t i = 0; i < points.size(); i++)
+		for(size_t j = i + 1; j < points.size(); j++) {
+			float dx = points[j].x - points[i].x, dz = points[j].z - points[i].z;
+			if(dx * dx + dz * dz <= distance * distance) out.insert({cs381::Entity(i), cs381::Entity(j)});
+		}
+	return out;
+}
+
+void CheckQueries(const std::vector<Point>& points, float cellSize, std::mt19937& random) {
+	cs381::SpatialHash grid(cellSize);
+	for(size_t i = 0; i < points.size(); i++)
+		grid.Insert(cs381::Entity(i), points[i].x, points[i].z);
+	grid.Build();
+
+	std::vector<cs381::SpatialHash::Pair> pairs, parallelPairs;
+	grid.FindPairs(cellSize, pairs);
+	CHECK(Normalized(pairs) == BruteForcePairs(points, cellSize));
+	grid.ParallelFindPairs(cellSize, parallelPairs, 16);						// small grain, so the work is split over many chunks
+	CHECK(parallelPairs.size() == pairs.size());
+	for(size_t i = 0; i < pairs.size(); i++)
+		CHECK(parallelPairs[i].a == pairs[i].a && parallelPairs[i].b == pairs[i].b);
+
+	std::uniform_real_distribution<float> coordinate(-60, 60), extent(0, 30);
+	for(int query = 0; query < 200; query++) {
+		float x = coordinate(random), z = coordinate(random);
+		float width = query % 10 == 0 ? 200 : extent(random), depth = extent(random);	// some boxes cover more cells than there are items
+		std::set<cs381::Entity> found, expected;
+		grid.ForEachInBox(x, z, x + width, z + depth, [&](const cs381::SpatialHash::Item& item) { CHECK(found.insert(item.entity).second); });
+		for(size_t i = 0; i < points.size(); i++)
+			if(points[i].x >= x && points[i].x <= x + width && points[i].z >= z && points[i].z <= z + depth) expected.insert(cs381::Entity(i));
+		CHECK(found == expected);
+
+		float radius = extent(random) / 2;
+		found.clear();
+		expected.clear();
+		grid.ForEachInRadius(x, z, radius, [&](const cs381::SpatialHash::Item& item) { CHECK(found.insert(item.entity).second); });
+		for(size_t i = 0; i < points.size(); i++) {
+			float dx = points[i].x - x, dz = points[i].z - z;
+			if(dx * dx + dz * dz <= radius * radius) expected.insert(cs381::Entity(i));
+		}
+		CHECK(found == expected);
+	}
+}
+
+int main() {
+	std::mt19937 random(381);
+
+	// scattered over negative and positive coordinates, with clusters dense enough to fill cells and their neighbours
+	std::uniform_real_distribution<float> spread(-50, 50), cluster(-3, 3);
+	std::vector<Point> points;
+	for(int i = 0; i < 1500; i++)
+		points.push_back({spread(random), spread(random)});
+	for(int i = 0; i < 500; i++)
+		points.push_back({-20 + cluster(random), -35 + cluster(random)});
+	CheckQueries(points, 4, random);
+
+	// two clumps of points in far apart cells that land in the same bucket: neither queries nor pairs may mix them up
+	cs381::SpatialHash probe(4);
+	for(int i = 0; i < 20; i++)
+		probe.Insert(cs381::Entity(i), 0, 0);
+	probe.Build();															// the same bucket count as the 20 points below get
+	int32_t cellX = -3, cellZ = -2, otherX = 0, otherZ = 0;
+	bool shared = false;
+	for(int32_t x = -200; x <= 200 && !shared; x++)
+		for(int32_t z = -200; z <= 200 && !shared; z++)
+			if((x != cellX || z != cellZ) && std::max(std::abs(x - cellX), std::abs(z - cellZ)) > 1 && probe.Bucket(x, z) == probe.Bucket(cellX, cellZ)) {
+				otherX = x;
+				otherZ = z;
+				shared = true;
+			}
+	CHECK(shared);
+	std::vector<Point> clumps;
+	for(int i = 0; i < 10; i++) {
+		clumps.push_back({cellX * 4 + 0.2f + i * 0.3f, cellZ * 4 + 0.5f});
+		clumps.push_back({otherX * 4 + 0.2f + i * 0.3f, otherZ * 4 + 0.5f});
+	}
+	CheckQueries(clumps, 4, random);
+	return 0;
+}
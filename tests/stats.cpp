@@ -0,0 +1,77 @@
+#include "ECS.hpp"
+#include "check.hpp"
+
+struct Position { float x, y, z, w; };
+struct Health { int points; };
+struct Frozen {};
+struct Unused { double value[3]; };
+
+template<> struct cs381::ComponentRegistry<> : cs381::ComponentList<Position, Health, Frozen, Unused> {};
+
+constexpr size_t PositionID = cs381::GetComponentID<Position>(), HealthID = cs381::GetComponentID<Health>(), FrozenID = cs381::GetComponentID<Frozen>(), UnusedID = cs381::GetComponentID<Unused>();
+
+// 100 entities with a Position, every other one with Health and every tenth Frozen, then every tenth destroyed
+template<typename Tscene>
+cs381::SceneStats Populate(Tscene& scene) {
+	for(size_t i = 0; i < 100; i++) {
+		cs381::Entity e = scene.CreateEntity();
+		scene.template AddComponent<Position>(e);
+		if(i % 2 == 0) scene.template AddComponent<Health>(e);
+		if(i % 10 == 5) scene.template AddComponent<Frozen>(e);
+	}
+	for(size_t i = 0; i < 100; i += 10)
+		scene.DestroyEntity(scene.GetEntity(i));
+	return scene.Stats();
+}
+
+// what every storage reports alike
+void CheckCommon(const cs381::SceneStats& stats) {
+	CHECK(stats.components.size() == 4 && stats.components[PositionID].name == "Position" && stats.components[UnusedID].name == "Unused");
+	CHECK(stats.entities == 90 && stats.slots == 100 && stats.freeSlots == 10);
+	CHECK(stats.components[PositionID].live == 90 && stats.components[HealthID].live == 40 && stats.components[FrozenID].live == 10);
+	CHECK(stats.components[PositionID].elementSize == sizeof(Position) && stats.components[HealthID].elementSize == sizeof(Health));
+	CHECK(stats.components[FrozenID].elementSize == 0 && stats.components[FrozenID].capacityBytes == 0 && stats.components[FrozenID].wastedBytes == 0);	// tags take no memory
+	CHECK(stats.components[UnusedID].elementSize == sizeof(Unused) && stats.components[UnusedID].live == 0 && stats.components[UnusedID].stored == 0);
+	CHECK(stats.maskBytes >= 100 * sizeof(cs381::Signature) && stats.changeBytes >= 90 * sizeof(cs381::ChangeTracker::Stamp));
+	for(auto& component: stats.components)
+		CHECK(component.capacityBytes >= component.live * component.elementSize && component.wastedBytes == component.capacityBytes - component.live * component.elementSize);
+	size_t total = stats.maskBytes + stats.entityBytes + stats.indexBytes + stats.queryBytes + stats.changeBytes;
+	for(auto& component: stats.components)
+		total += component.capacityBytes + component.indexBytes;
+	CHECK(stats.TotalBytes() == total && stats.ComponentBytes() <= total);
+}
+
+int main() {
+	// the flat storage keeps a slot for every entity up to the last one holding the component, destroyed or not
+	cs381::Scene<cs381::ComponentStorage> flat;
+	auto stats = Populate(flat);
+	CheckCommon(stats);
+	CHECK(stats.components[PositionID].stored == 100 && stats.components[HealthID].stored == 99);
+	CHECK(stats.components[PositionID].fragmentation == 1 - 90.0f / 100 && stats.components[PositionID].indexBytes == 0);
+	CHECK(stats.components[HealthID].wastedBytes >= 59 * sizeof(Health));
+
+	// sparse sets free a destroyed entity's component, so they hold live components only, at the price of an index
+	cs381::Scene<cs381::SparseSetComponentStorage> sparse;
+	stats = Populate(sparse);
+	CheckCommon(stats);
+	CHECK(stats.components[PositionID].stored == 90 && stats.components[HealthID].stored == 40 && stats.components[PositionID].fragmentation == 0);
+	CHECK(stats.components[PositionID].indexBytes > 0 && stats.components[UnusedID].indexBytes == 0);
+
+	// copy-on-write pages report the part shared with a fork, the fork's writes unshare it on both sides
+	cs381::Scene<cs381::CowComponentStorage> cow;
+	stats = Populate(cow);
+	CheckCommon(stats);
+	CHECK(stats.components[PositionID].sharedBytes == 0 && stats.changeSharedBytes == 0);
+	auto fork = cow.Fork();
+	stats = cow.Stats();
+	CHECK(stats.components[PositionID].sharedBytes == stats.components[PositionID].capacityBytes && stats.changeSharedBytes == stats.changeBytes - stats.changeBytes % cs381::CowComponentStorage::PageBytes);
+	fork.GetMutable<Position>(fork.GetEntity(1)).x = 1;
+	CHECK(cow.Stats().components[PositionID].sharedBytes == 0 && cow.Stats().components[HealthID].sharedBytes == cow.Stats().components[HealthID].capacityBytes);
+
+	// archetypes count the unused rows at the end of their chunks as stored
+	cs381::Scene<cs381::ArchetypeStorage> archetypes;
+	stats = Populate(archetypes);
+	CheckCommon(stats);
+	CHECK(stats.components[PositionID].stored >= 90 && stats.components[PositionID].fragmentation == 1 - 90.0f / stats.components[PositionID].stored && stats.indexBytes > 0);
+	return 0;
+}